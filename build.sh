@@ -27,6 +27,8 @@ fi
 mkdir linux_build
 	
 cd src
+build x86-64-vnni512
+build x86-64-avx512
 build x86-64-bmi2
 build x86-64-avx2
 build x86-64-modern
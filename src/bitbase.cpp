@@ -17,19 +17,29 @@
 */
 
 #include <cassert>
+#include <cstring>
+#include <ostream>
 #include <vector>
-#include <bitset>
 
 #include "bitboard.h"
 #include "types.h"
 
+#if defined(USE_EMBEDDED_TABLES)
+#include "incbin/incbin.h"
+
+// The bitbase computed at build time by tablegen, see the Makefile
+INCBIN(KPKBitbase, "kpk.bin");
+#endif
+
 namespace {
 
   // There are 24 possible pawn squares: files A to D and ranks from 2 to 7.
   // Positions with the pawn on files E to H will be mirrored before probing.
   constexpr unsigned MAX_INDEX = 2*24*64*64; // stm * psq * wksq * bksq = 196608
 
-  std::bitset<MAX_INDEX> KPKBitbase;
+  // Each byte stores results of 8 positions, one per bit, so that the bitbase
+  // embedded at build time does not depend on the byte order
+  uint8_t KPKBitbase[MAX_INDEX / 8];
 
   // A KPK bitbase index is an integer in [0, IndexMax] range
   //
@@ -71,12 +81,21 @@ bool Bitbases::probe(Square wksq, Square wpsq, Square bksq, Color stm) {
 
   assert(file_of(wpsq) <= FILE_D);
 
-  return KPKBitbase[index(stm, bksq, wksq, wpsq)];
+  unsigned idx = index(stm, bksq, wksq, wpsq);
+  return KPKBitbase[idx / 8] & (1 << (idx & 7));
 }
 
 
 void Bitbases::init() {
 
+#if defined(USE_EMBEDDED_TABLES)
+  if (gKPKBitbaseSize == sizeof(KPKBitbase))
+  {
+      std::memcpy(KPKBitbase, gKPKBitbaseData, sizeof(KPKBitbase));
+      return;
+  }
+#endif
+
   std::vector<KPKPosition> db(MAX_INDEX);
   unsigned idx, repeat = 1;
 
@@ -93,7 +112,16 @@ void Bitbases::init() {
   // Fill the bitbase with the decisive results
   for (idx = 0; idx < MAX_INDEX; ++idx)
       if (db[idx] == WIN)
-          KPKBitbase.set(idx);
+          KPKBitbase[idx / 8] |= 1 << (idx & 7);
+}
+
+
+/// Bitbases::write() writes the bitbase computed by init(), for tablegen to
+/// embed it in the engine at build time.
+
+void Bitbases::write(std::ostream& os) {
+
+  os.write(reinterpret_cast<const char*>(KPKBitbase), sizeof(KPKBitbase));
 }
 
 
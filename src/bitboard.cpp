@@ -18,10 +18,20 @@
 
 #include <algorithm>
 #include <bitset>
+#include <cstddef> // For offsetof()
+#include <cstring> // For std::memcpy
+#include <ostream>
 
 #include "bitboard.h"
 #include "misc.h"
 
+#if defined(USE_EMBEDDED_TABLES)
+#include "incbin/incbin.h"
+
+// The magic tables computed at build time by tablegen, see the Makefile
+INCBIN(MagicTables, "magics.bin");
+#endif
+
 uint8_t PopCnt16[1 << 16];
 uint8_t SquareDistance[SQUARE_NB][SQUARE_NB];
 
@@ -38,7 +48,20 @@ namespace {
   Bitboard RookTable[0x19000];  // To store rook attacks
   Bitboard BishopTable[0x1480]; // To store bishop attacks
 
-  void init_magics(PieceType pt, Bitboard table[], Magic magics[]);
+  // The layout of the tables written by Bitboards::write(). The format tells
+  // whether the attacks are indexed with pext and the magics are for 64 bits.
+  struct MagicTables {
+    uint64_t format;
+    Bitboard magics[2][SQUARE_NB]; // Rooks, then bishops
+    Bitboard rookTable[0x19000];
+    Bitboard bishopTable[0x1480];
+  };
+
+  // Neither 0 nor the same once byte-swapped, so that empty tables, or tables
+  // written on a machine with the other byte order, are not used
+  constexpr uint64_t TablesFormat = 4 + HasPext * 1 + Is64Bit * 2;
+
+  void init_magics(PieceType pt, Bitboard table[], Magic magics[], const Bitboard* knownMagics);
 
 }
 
@@ -87,8 +110,30 @@ void Bitboards::init() {
       for (Square s2 = SQ_A1; s2 <= SQ_H8; ++s2)
           SquareDistance[s1][s2] = std::max(distance<File>(s1, s2), distance<Rank>(s1, s2));
 
-  init_magics(ROOK, RookTable, RookMagics);
-  init_magics(BISHOP, BishopTable, BishopMagics);
+  const Bitboard* rookMagics = nullptr;
+  const Bitboard* bishopMagics = nullptr;
+
+#if defined(USE_EMBEDDED_TABLES)
+  // Copy the tables computed at build time, if they are for this build
+  uint64_t format = 0;
+  Bitboard magics[2][SQUARE_NB];
+
+  // The tables are empty when tablegen could not run on the build machine
+  if (gMagicTablesSize == sizeof(MagicTables))
+      std::memcpy(&format, gMagicTablesData, sizeof(format));
+
+  if (format == TablesFormat)
+  {
+      std::memcpy(magics, gMagicTablesData + offsetof(MagicTables, magics), sizeof(magics));
+      std::memcpy(RookTable, gMagicTablesData + offsetof(MagicTables, rookTable), sizeof(RookTable));
+      std::memcpy(BishopTable, gMagicTablesData + offsetof(MagicTables, bishopTable), sizeof(BishopTable));
+      rookMagics = magics[0];
+      bishopMagics = magics[1];
+  }
+#endif
+
+  init_magics(ROOK, RookTable, RookMagics, rookMagics);
+  init_magics(BISHOP, BishopTable, BishopMagics, bishopMagics);
 
   for (Square s1 = SQ_A1; s1 <= SQ_H8; ++s1)
   {
@@ -112,6 +157,27 @@ void Bitboards::init() {
 }
 
 
+
+/// Bitboards::write() writes the magics and the attack tables computed by init(),
+/// in the layout of MagicTables, for tablegen to embed them in the engine at
+/// build time.
+
+void Bitboards::write(std::ostream& os) {
+
+  auto put = [&](const void* data, size_t size) {
+      os.write(static_cast<const char*>(data), std::streamsize(size));
+  };
+
+  put(&TablesFormat, sizeof(TablesFormat));
+
+  for (Magic* magics : { RookMagics, BishopMagics })
+      for (Square s = SQ_A1; s <= SQ_H8; ++s)
+          put(&magics[s].magic, sizeof(Bitboard));
+
+  put(RookTable, sizeof(RookTable));
+  put(BishopTable, sizeof(BishopTable));
+}
+
 namespace {
 
   Bitboard sliding_attack(PieceType pt, Square sq, Bitboard occupied) {
@@ -134,9 +200,10 @@ namespace {
   // init_magics() computes all rook and bishop attacks at startup. Magic
   // bitboards are used to look up attacks of sliding pieces. As a reference see
   // www.chessprogramming.org/Magic_Bitboards. In particular, here we use the so
-  // called "fancy" approach.
+  // called "fancy" approach. When the magics and the attacks are known, as
+  // computed at build time, only the masks and the offsets are set up.
 
-  void init_magics(PieceType pt, Bitboard table[], Magic magics[]) {
+  void init_magics(PieceType pt, Bitboard table[], Magic magics[], const Bitboard* knownMagics) {
 
     // Optimal PRNG seeds to pick the correct magics in the shortest time
     int seeds[][RANK_NB] = { { 8977, 44560, 54343, 38998,  5731, 95205, 104912, 17020 },
@@ -163,6 +230,13 @@ namespace {
         // table sizes for each square with "Fancy Magic Bitboards".
         m.attacks = s == SQ_A1 ? table : magics[s - 1].attacks + size;
 
+        if (knownMagics)
+        {
+            m.magic = knownMagics[s];
+            size = 1 << popcount(m.mask);
+            continue;
+        }
+
         // Use Carry-Rippler trick to enumerate all subsets of masks[s] and
         // store the corresponding sliding attack bitboard in reference[].
         b = size = 0;
@@ -19,6 +19,7 @@
 #ifndef BITBOARD_H_INCLUDED
 #define BITBOARD_H_INCLUDED
 
+#include <iosfwd>
 #include <string>
 
 #include "types.h"
@@ -26,6 +27,7 @@
 namespace Bitbases {
 
 void init();
+void write(std::ostream& os);
 bool probe(Square wksq, Square wpsq, Square bksq, Color us);
 
 }
@@ -33,6 +35,7 @@ bool probe(Square wksq, Square wpsq, Square bksq, Color us);
 namespace Bitboards {
 
 void init();
+void write(std::ostream& os);
 const std::string pretty(Bitboard b);
 
 }
@@ -96,9 +96,16 @@ namespace Eval {
         {
             if (directory != "<internal>")
             {
-                ifstream stream(directory + eval_file, ios::binary);
-                if (load_eval(eval_file, stream))
+                // A blob written by "export_blob" is mapped read-only and shared
+                // between processes, otherwise the file is parsed as a .nnue net
+                if (map_blob(directory + eval_file))
                     eval_file_loaded = eval_file;
+                else
+                {
+                    ifstream stream(directory + eval_file, ios::binary);
+                    if (load_eval(eval_file, stream))
+                        eval_file_loaded = eval_file;
+                }
             }
 
             if (directory == "<internal>" && eval_file == EvalFileDefaultName)
@@ -1110,3 +1117,37 @@ std::string Eval::trace(const Position& pos) {
 
   return ss.str();
 }
+
+namespace {
+  volatile int benchmark_sink;
+}
+
+/// benchmark() times the classical evaluation and, when NNUE is in use, each
+/// stage of the network evaluation on the given positions. Each stage runs
+/// 'iterations' times over all the positions so that short calls can be timed.
+
+Eval::StageTimings Eval::benchmark(Position* const positions[], std::size_t count, int iterations) {
+
+  StageTimings timings;
+  Stopwatch watch;
+  int sum = 0;
+
+  for (std::size_t i = 0; i < count; ++i)
+      positions[i]->this_thread()->contempt = SCORE_ZERO;
+
+  watch.start();
+  for (int it = 0; it < iterations; ++it)
+      for (std::size_t i = 0; i < count; ++i)
+          sum += Evaluation<NO_TRACE>(*positions[i]).value();
+  watch.stop(count * iterations);
+
+  timings.emplace_back("Evaluation<NO_TRACE>", watch);
+
+  if (useNNUE)
+      NNUE::benchmark(positions, count, iterations, timings);
+
+  // Make sure the compiler keeps the evaluations
+  benchmark_sink = sum;
+
+  return timings;
+}
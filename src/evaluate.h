@@ -20,15 +20,22 @@
 #define EVALUATE_H_INCLUDED
 
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "misc.h"
 #include "types.h"
 
 class Position;
 
 namespace Eval {
 
+  // Time spent in each stage of the evaluation, reported by "bench eval"
+  typedef std::vector<std::pair<std::string, Stopwatch>> StageTimings;
+
   std::string trace(const Position& pos);
   Value evaluate(const Position& pos);
+  StageTimings benchmark(Position* const positions[], std::size_t count, int iterations);
 
   extern bool useNNUE;
   extern std::string eval_file_loaded;
@@ -41,7 +48,11 @@ namespace Eval {
   namespace NNUE {
 
     Value evaluate(const Position& pos);
+    void evaluate(const Position* const positions[], std::size_t count, Value values[]);
     bool load_eval(std::string name, std::istream& stream);
+    bool map_blob(const std::string& name);
+    bool export_blob(const std::string& name);
+    void benchmark(Position* const positions[], std::size_t count, int iterations, StageTimings& timings);
     void init();
     void verify();
 
@@ -0,0 +1,402 @@
+/*
+  SugaR, a UCI chess playing engine derived from Stockfish
+  Copyright (C) 2004-2021 The Stockfish developers (see AUTHORS file)
+
+  SugaR is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  SugaR is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <climits>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include "idea.h"
+#include "misc.h"
+#include "movegen.h"
+#include "position.h"
+#include "thread.h"
+#include "uci.h"
+
+#include "experience.h"
+
+namespace Idea {
+
+namespace {
+
+  // A Node of the tree. Its value is from the point of view of the side to move
+  // at the node: the result of its own search once it has been searched (depth
+  // is then not zero), else the score of its move in the search of the parent.
+  struct Node {
+    size_t index;
+    Node* parent;
+    Move move;
+    Value value;
+    Depth depth;
+    bool busy, terminal;
+    std::vector<Node*> children;
+  };
+
+  // The nodes are never removed, so a deque keeps the pointers to them valid.
+  // The root is the first node, and the parents come before their children.
+  std::deque<Node> tree;
+  std::mutex mutex;
+  std::condition_variable cv;
+
+  std::string rootFen, treeFile;
+  std::ofstream treeOut;
+  bool chess960, active;
+  size_t width, leavesLeft, running;
+
+  // The values of a node and of its children are one ply apart, which moves the
+  // mate scores one ply away from or towards the mate.
+  Value to_parent(Value v) {
+    return v >= VALUE_MATE_IN_MAX_PLY ? -v + 1 : v <= VALUE_MATED_IN_MAX_PLY ? -v - 1 : -v;
+  }
+
+  Value to_child(Value v) {
+    return v >= VALUE_MATE_IN_MAX_PLY ? -v - 1 : v <= VALUE_MATED_IN_MAX_PLY ? -v + 1 : -v;
+  }
+
+
+  // best_leaf() finds the free leaf with the best minimax priority, that is with
+  // the smallest sum along its path of the drops from the value of the best move.
+
+  void best_leaf(Node* n, int cost, Node*& best, int& bestCost) {
+
+    if (n->children.empty())
+    {
+        if (!n->busy && !n->terminal && cost < bestCost)
+            best = n, bestCost = cost;
+        return;
+    }
+
+    for (Node* c : n->children)
+        best_leaf(c, cost + n->value - to_parent(c->value), best, bestCost);
+  }
+
+
+  // back_up() updates the values of the ancestors of a node by minimax, keeping
+  // the children sorted from the best one.
+
+  void back_up(Node* n) {
+
+    for ( ; n; n = n->parent)
+    {
+        if (n->children.empty())
+            continue;
+
+        std::stable_sort(n->children.begin(), n->children.end(), [](Node* a, Node* b) {
+            return to_parent(a->value) > to_parent(b->value);
+        });
+
+        n->value = to_parent(n->children[0]->value);
+    }
+  }
+
+
+  // main_line() returns the moves of the best line from a node in UCI notation
+
+  std::string main_line(const Node* n) {
+
+    std::string pv;
+
+    for ( ; n; n = n->children.empty() ? nullptr : n->children[0])
+        if (n->move != MOVE_NONE)
+            pv += " " + UCI::move(n->move, chess960);
+
+    return pv;
+  }
+
+
+  // path() returns the moves from the root to a node
+
+  std::vector<Move> path(const Node* n) {
+
+    std::vector<Move> moves;
+
+    for ( ; n->parent; n = n->parent)
+        moves.push_back(n->move);
+
+    std::reverse(moves.begin(), moves.end());
+    return moves;
+  }
+
+
+  // save() appends a node to the tree file, after the root position: its index,
+  // the index of its parent, its move, value, depth and whether it is terminal.
+  // A searched leaf is written again, the last line of a node being the one read
+  // back. Called with the mutex locked.
+
+  void save(const Node& n) {
+
+    treeOut << n.index << " " << (n.parent ? long(n.parent->index) : -1L) << " "
+            << UCI::move(n.move, true) << " " << n.value << " "
+            << n.depth << " " << n.terminal << "\n";
+  }
+
+
+  // load() reads the tree from its file, if it was grown from the same root.
+  // The moves are read back from the position of their parent, which is set up
+  // from its FEN once for its children, as they follow each other in the file.
+
+  void load() {
+
+    std::ifstream file(treeFile);
+    std::string line, move;
+    std::vector<std::string> fens;
+    size_t index;
+    long parent, lastParent = -1;
+    int value, depth;
+    bool terminal;
+    StateInfo rootState, st;
+    Position pos;
+
+    if (!getline(file, line) || line != "fen " + rootFen)
+        return;
+
+    while (file >> index >> parent >> move >> value >> depth >> terminal)
+    {
+        // A searched leaf, written again with its search result
+        if (index < tree.size())
+        {
+            Node& n = tree[index];
+
+            if ((n.parent ? long(n.parent->index) : -1L) != parent)
+                break;
+
+            n.value = Value(value), n.depth = Depth(depth), n.terminal = terminal;
+            continue;
+        }
+
+        Move m = MOVE_NONE;
+
+        if (index != tree.size())
+            break;
+
+        if (parent >= 0)
+        {
+            if (size_t(parent) >= tree.size())
+                break;
+
+            if (parent != lastParent)
+                pos.set(fens[parent], chess960, &rootState, Threads.main());
+
+            lastParent = parent;
+
+            if ((m = UCI::to_move(pos, move)) == MOVE_NONE)
+                break;
+
+            pos.do_move(m, st);
+            fens.push_back(pos.fen());
+            pos.undo_move(m);
+        }
+        else if (!tree.empty())
+            break;
+        else
+            fens.push_back(rootFen);
+
+        tree.push_back({index, parent >= 0 ? &tree[parent] : nullptr, m, Value(value), Depth(depth), false, terminal, {}});
+
+        if (parent >= 0)
+            tree[parent].children.push_back(&tree.back());
+    }
+
+    // Start again from the root if the file is not a tree of this position
+    if (!file.eof() || tree.empty() || tree[0].parent)
+        tree.clear();
+
+    for (Node& n : tree)
+        if (n.children.empty() && n.parent)
+            back_up(n.parent);
+  }
+
+} // namespace
+
+
+/// Idea::building() tells the threads started by build() to work on the tree
+
+bool building() {
+  return active;
+}
+
+
+/// Idea::build() grows the tree of the position by 'leaves' searches of 'depth'
+/// plies, each of them adding up to 'width' children to the searched leaf. The
+/// tree is read from and saved to the file, named after the position by default.
+
+void build(Position& pos, Depth depth, size_t w, size_t leaves, std::string fileName) {
+
+  if (fileName.empty())
+  {
+      std::stringstream ss;
+      ss << "idea_" << std::hex << std::setfill('0') << std::setw(16) << pos.key() << ".tree";
+      fileName = ss.str();
+  }
+
+  rootFen = pos.fen();
+  chess960 = pos.is_chess960();
+  treeFile = fileName;
+  width = w;
+  leavesLeft = leaves;
+  running = 0;
+
+  tree.clear();
+  load();
+
+  if (tree.empty())
+  {
+      tree.push_back({0, nullptr, MOVE_NONE, VALUE_ZERO, 0, false, false, {}});
+      treeOut.open(treeFile);
+      treeOut << "fen " << rootFen << "\n";
+      save(tree[0]);
+  }
+  else
+  {
+      treeOut.open(treeFile, std::ios::app);
+      sync_cout << "info string Growing the tree of " << tree.size() << " nodes in " << treeFile << sync_endl;
+  }
+
+  Search::LimitsType limits;
+  limits.depth = depth;
+  limits.startTime = now();
+
+  active = true;
+  Threads.start_analysis({}, limits, width);
+  Threads.main()->wait_for_search_finished();
+  active = false;
+  treeOut.close();
+
+  Experience::save();
+
+  // Report the lines of the root moves, from the best one
+  size_t i = 0;
+  for (const Node* c : tree[0].children)
+      sync_cout << "info multipv " << ++i
+                << " score " << UCI::value(to_parent(c->value), to_parent(c->value))
+                << " nodes " << Threads.nodes_searched()
+                << " pv" << main_line(c) << sync_endl;
+
+  sync_cout << "info string Tree of " << tree.size() << " nodes saved to " << treeFile << sync_endl;
+}
+
+
+/// Idea::work() is the loop of the threads building a tree. A thread takes the
+/// free leaf with the best priority, searches it, adds the best moves of the
+/// search as children of the leaf, and backs up their values.
+
+void work(Thread* th) {
+
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (true)
+  {
+      Node* leaf = nullptr;
+
+      // Wait for a free leaf. When there is none while no thread is searching,
+      // all the leaves are terminal.
+      cv.wait(lock, [&]{
+          int bestCost = INT_MAX;
+          leaf = nullptr;
+
+          if (Threads.stop || !leavesLeft)
+              return true;
+
+          best_leaf(&tree[0], 0, leaf, bestCost);
+          return leaf || !running;
+      });
+
+      if (!leaf)
+          break;
+
+      leaf->busy = true;
+      --leavesLeft;
+      ++running;
+
+      std::vector<Move> moves = path(leaf);
+      lock.unlock();
+
+      std::deque<StateInfo> states(moves.size());
+      th->rootPos.set(rootFen, chess960, &th->rootState, th);
+
+      for (size_t i = 0; i < moves.size(); ++i)
+          th->rootPos.do_move(moves[i], states[i]);
+
+      bool searched = th->search_position();
+
+      lock.lock();
+      --running;
+      leaf->busy = false;
+
+      if (Threads.stop)
+          break;
+
+      if (!searched)
+      {
+          leaf->terminal = true;
+          leaf->value = th->rootPos.checkers() ? -VALUE_MATE : VALUE_DRAW;
+      }
+      else
+      {
+          leaf->depth = th->completedDepth;
+
+          for (size_t i = 0; i < std::min(width, th->rootMoves.size()); ++i)
+          {
+              const Search::RootMove& rm = th->rootMoves[i];
+              Value v = rm.score != -VALUE_INFINITE ? rm.score : rm.previousScore;
+
+              if (v != -VALUE_INFINITE)
+              {
+                  tree.push_back({tree.size(), leaf, rm.pv[0], to_child(v), 0, false, false, {}});
+                  leaf->children.push_back(&tree.back());
+              }
+          }
+
+          const Search::RootMove& best = th->rootMoves[0];
+
+          if (    Experience::enabled()
+              && !Experience::is_learning_paused()
+              && !chess960
+              && !(bool)Options["Experience Readonly"]
+              &&  th->completedDepth >= MIN_EXP_DEPTH)
+              Experience::add_pv_experience(th->rootPos.key(), best.pv[0], best.score, th->completedDepth);
+      }
+
+      // Write the result of the leaf and its new children, before the back up
+      // changes the values of the leaf and its ancestors, which load() redoes.
+      save(*leaf);
+
+      for (const Node* c : leaf->children)
+          save(*c);
+
+      treeOut.flush();
+      back_up(leaf);
+
+      sync_cout << "info depth " << Search::Limits.depth
+                << " score " << UCI::value(tree[0].value, tree[0].value)
+                << " nodes " << Threads.nodes_searched()
+                << " pv" << main_line(&tree[0])
+                << " string " << tree.size() << " nodes" << sync_endl;
+
+      cv.notify_all();
+  }
+
+  cv.notify_all();
+}
+
+} // namespace Idea
@@ -0,0 +1,42 @@
+/*
+  SugaR, a UCI chess playing engine derived from Stockfish
+  Copyright (C) 2004-2021 The Stockfish developers (see AUTHORS file)
+
+  SugaR is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  SugaR is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IDEA_H_INCLUDED
+#define IDEA_H_INCLUDED
+
+#include <string>
+
+#include "types.h"
+
+class Position;
+class Thread;
+
+/// The "idea" command grows an analysis tree from the current position: the
+/// threads search its leaves to a fixed depth, best minimax priority first,
+/// and the scores are backed up to the root. The tree is kept in a file, so
+/// that the next "idea" from the same position goes on growing it.
+
+namespace Idea {
+
+bool building();
+void build(Position& pos, Depth depth, size_t width, size_t leaves, std::string fileName);
+void work(Thread* th);
+
+} // namespace Idea
+
+#endif // #ifndef IDEA_H_INCLUDED
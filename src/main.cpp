@@ -38,8 +38,17 @@ namespace PSQT {
 
 int main(int argc, char* argv[]) {
 
+  // Each step of the initialization is timed, for "bench startup"
+  auto step = [](const char* name, auto init) {
+      Stopwatch watch;
+      watch.start();
+      init();
+      watch.stop();
+      UCI::startupTimes.emplace_back(name, watch.nanoseconds);
+  };
+
   Utility::init(argv[0]);
-  SysInfo::init();
+  step("SysInfo::init()", SysInfo::init);
   show_logo();
 
   std::cout << engine_info() << std::endl;
@@ -57,20 +66,20 @@ int main(int argc, char* argv[]) {
       << "L1/L2/L3 cache size   : " << SysInfo::cache_info(0) << "/" << SysInfo::cache_info(1) << "/" << SysInfo::cache_info(2) << std::endl
       << "Memory installed (RAM): " << SysInfo::total_memory() << std::endl << std::endl;
 
-  UCI::init(Options);
+  step("UCI::init()",         []{ UCI::init(Options); });
   Tune::init();
-  PSQT::init();
-  Bitboards::init();
-  Position::init();
-  Bitbases::init();
-  Endgames::init();
-  Experience::init();
-  Threads.set(size_t(Options["Threads"]));
-  Threads.setFull(Options["BruteForceSearch"]);
-  polybook.init(Options["BookFile"]);
-  polybook2.init(Options["BookFile2"]);
-  Search::clear(); // After threads are up
-  Eval::NNUE::init();
+  step("PSQT::init()",        PSQT::init);
+  step("Bitboards::init()",   Bitboards::init);
+  step("Position::init()",    Position::init);
+  step("Bitbases::init()",    Bitbases::init);
+  step("Endgames::init()",    Endgames::init);
+  step("Experience::init()",  Experience::init);
+  step("Threads.set()",       []{ Threads.set(size_t(Options["Threads"]));
+                                  Threads.setFull(Options["BruteForceSearch"]); });
+  step("polybook.init()",     []{ polybook.init(Options["BookFile"]);
+                                  polybook2.init(Options["BookFile2"]); });
+  step("Search::clear()",     Search::clear); // After threads are up
+  step("Eval::NNUE::init()",  Eval::NNUE::init);
 
   UCI::loop(argc, argv);
 
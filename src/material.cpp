@@ -125,11 +125,16 @@ namespace Material {
 Entry* probe(const Position& pos) {
 
   Key key = pos.material_key();
-  Entry* e = pos.this_thread()->materialTable[key];
+  Table& table = pos.this_thread()->materialTable;
+  Entry* e = table[key];
 
   if (e->key == key)
+  {
+      ++table.hits;
       return e;
+  }
 
+  ++table.misses;
   std::memset(e, 0, sizeof(Entry));
   e->key = key;
   e->factor[WHITE] = e->factor[BLACK] = (uint8_t)SCALE_FACTOR_NORMAL;
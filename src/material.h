@@ -62,7 +62,7 @@ struct Entry {
   uint8_t factor[COLOR_NB];
 };
 
-typedef HashTable<Entry, 8192> Table;
+typedef HashTable<Entry> Table;
 
 Entry* probe(const Position& pos);
 
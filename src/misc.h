@@ -21,11 +21,18 @@
 
 #include <cassert>
 #include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
 #include <ostream>
 #include <string>
 #include <vector>
 #include <cstdint>
 
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h> // For __rdtsc()
+#endif
+
 #include "types.h"
 
 class Position;
@@ -69,12 +76,81 @@ inline TimePoint now() {
         (std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
-template<class Entry, int Size>
+/// cpu_cycles() reads the time stamp counter of the CPU, it returns 0 on
+/// targets where it is not available.
+inline uint64_t cpu_cycles() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  return 0;
+#endif
+}
+
+/// Stopwatch sums the nanoseconds and the CPU cycles spent between start()
+/// and stop(), together with the number of calls timed in between.
+struct Stopwatch {
+
+  void start() {
+    startCycles = cpu_cycles();
+    startTime = std::chrono::steady_clock::now();
+  }
+
+  void stop(uint64_t count = 1) {
+    nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>
+                  (std::chrono::steady_clock::now() - startTime).count();
+    cycles += cpu_cycles() - startCycles;
+    calls += count;
+  }
+
+  uint64_t calls = 0, nanoseconds = 0, cycles = 0;
+
+private:
+  std::chrono::steady_clock::time_point startTime;
+  uint64_t startCycles;
+};
+
+/// HashTable is a direct-mapped table indexed by the low bits of the key, as
+/// the per-thread pawn and material tables. resize() allocates it with large
+/// pages if possible, rounding the size in KB down to a power of two entries,
+/// and clears it. The owner counts its hits and misses.
+
+template<class Entry>
 struct HashTable {
-  Entry* operator[](Key key) { return &table[(uint32_t)key & (Size - 1)]; }
+
+  HashTable() = default;
+  HashTable(const HashTable&) = delete;
+  HashTable& operator=(const HashTable&) = delete;
+  ~HashTable() { aligned_large_pages_free(table); }
+
+  Entry* operator[](Key key) { return &table[key & mask]; }
+  size_t size() const { return mask + 1; }
+
+  void resize(size_t kbSize) {
+
+    size_t count = 1;
+    while (count * 2 * sizeof(Entry) <= kbSize * 1024)
+        count *= 2;
+
+    aligned_large_pages_free(table);
+    table = static_cast<Entry*>(aligned_large_pages_alloc(count * sizeof(Entry)));
+    if (!table)
+    {
+        std::cerr << "Failed to allocate " << kbSize << "KB for a hash table." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    mask = count - 1;
+    std::memset(static_cast<void*>(table), 0, count * sizeof(Entry));
+    hits = misses = 0;
+  }
+
+  uint64_t hits = 0, misses = 0;
 
 private:
-  std::vector<Entry> table = std::vector<Entry>(Size); // Allocate on the heap
+  Entry* table = nullptr;
+  size_t mask = 0;
 };
 
 
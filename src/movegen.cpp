@@ -26,14 +26,14 @@ namespace {
   template<GenType Type, Direction D>
   ExtMove* make_promotions(ExtMove* moveList, Square to, Square ksq) {
 
-    if (Type == CAPTURES || Type == EVASIONS || Type == NON_EVASIONS)
+    if (Type == CAPTURES || Type == EVASIONS || Type == NON_EVASIONS || Type == LEGAL)
     {
         *moveList++ = make<PROMOTION>(to - D, to, QUEEN);
         if (attacks_bb<KNIGHT>(to) & ksq)
             *moveList++ = make<PROMOTION>(to - D, to, KNIGHT);
     }
 
-    if (Type == QUIETS || Type == EVASIONS || Type == NON_EVASIONS)
+    if (Type == QUIETS || Type == EVASIONS || Type == NON_EVASIONS || Type == LEGAL)
     {
         *moveList++ = make<PROMOTION>(to - D, to, ROOK);
         *moveList++ = make<PROMOTION>(to - D, to, BISHOP);
@@ -61,9 +61,17 @@ namespace {
     Bitboard pawnsOn7    = pos.pieces(Us, PAWN) &  TRank7BB;
     Bitboard pawnsNotOn7 = pos.pieces(Us, PAWN) & ~TRank7BB;
 
-    Bitboard enemies = (Type == EVASIONS ? pos.pieces(Them) & target:
+    Bitboard enemies = (Type == EVASIONS || Type == LEGAL ? pos.pieces(Them) & target:
                         Type == CAPTURES ? target : pos.pieces(Them));
 
+    // For legal moves, a pinned pawn may only move along the ray of its king.
+    // The target is then the check mask, so blocking or capturing the checker.
+    [[maybe_unused]] const Square ourKsq = pos.square<KING>(Us);
+    [[maybe_unused]] const Bitboard pinned = pos.blockers_for_king(Us) & pos.pieces(Us, PAWN);
+    auto pinOk = [&](Square from, Square to) {
+        return Type != LEGAL || !(pinned & from) || aligned(from, to, ourKsq);
+    };
+
     // Single and double pawn pushes, no promotions
     if (Type != CAPTURES)
     {
@@ -72,7 +80,7 @@ namespace {
         Bitboard b1 = shift<Up>(pawnsNotOn7)   & emptySquares;
         Bitboard b2 = shift<Up>(b1 & TRank3BB) & emptySquares;
 
-        if (Type == EVASIONS) // Consider only blocking squares
+        if (Type == EVASIONS || Type == LEGAL) // Consider only blocking squares
         {
             b1 &= target;
             b2 &= target;
@@ -101,13 +109,15 @@ namespace {
         while (b1)
         {
             Square to = pop_lsb(&b1);
-            *moveList++ = make_move(to - Up, to);
+            if (pinOk(to - Up, to))
+                *moveList++ = make_move(to - Up, to);
         }
 
         while (b2)
         {
             Square to = pop_lsb(&b2);
-            *moveList++ = make_move(to - Up - Up, to);
+            if (pinOk(to - Up - Up, to))
+                *moveList++ = make_move(to - Up - Up, to);
         }
     }
 
@@ -117,7 +127,7 @@ namespace {
         if (Type == CAPTURES)
             emptySquares = ~pos.pieces();
 
-        if (Type == EVASIONS)
+        if (Type == EVASIONS || Type == LEGAL)
             emptySquares &= target;
 
         Bitboard b1 = shift<UpRight>(pawnsOn7) & enemies;
@@ -125,17 +135,29 @@ namespace {
         Bitboard b3 = shift<Up     >(pawnsOn7) & emptySquares;
 
         while (b1)
-            moveList = make_promotions<Type, UpRight>(moveList, pop_lsb(&b1), ksq);
+        {
+            Square to = pop_lsb(&b1);
+            if (pinOk(to - UpRight, to))
+                moveList = make_promotions<Type, UpRight>(moveList, to, ksq);
+        }
 
         while (b2)
-            moveList = make_promotions<Type, UpLeft >(moveList, pop_lsb(&b2), ksq);
+        {
+            Square to = pop_lsb(&b2);
+            if (pinOk(to - UpLeft, to))
+                moveList = make_promotions<Type, UpLeft >(moveList, to, ksq);
+        }
 
         while (b3)
-            moveList = make_promotions<Type, Up     >(moveList, pop_lsb(&b3), ksq);
+        {
+            Square to = pop_lsb(&b3);
+            if (pinOk(to - Up, to))
+                moveList = make_promotions<Type, Up     >(moveList, to, ksq);
+        }
     }
 
     // Standard and en passant captures
-    if (Type == CAPTURES || Type == EVASIONS || Type == NON_EVASIONS)
+    if (Type == CAPTURES || Type == EVASIONS || Type == NON_EVASIONS || Type == LEGAL)
     {
         Bitboard b1 = shift<UpRight>(pawnsNotOn7) & enemies;
         Bitboard b2 = shift<UpLeft >(pawnsNotOn7) & enemies;
@@ -143,13 +165,15 @@ namespace {
         while (b1)
         {
             Square to = pop_lsb(&b1);
-            *moveList++ = make_move(to - UpRight, to);
+            if (pinOk(to - UpRight, to))
+                *moveList++ = make_move(to - UpRight, to);
         }
 
         while (b2)
         {
             Square to = pop_lsb(&b2);
-            *moveList++ = make_move(to - UpLeft, to);
+            if (pinOk(to - UpLeft, to))
+                *moveList++ = make_move(to - UpLeft, to);
         }
 
         if (pos.ep_square() != SQ_NONE)
@@ -165,7 +189,22 @@ namespace {
             assert(b1);
 
             while (b1)
-                *moveList++ = make<EN_PASSANT>(pop_lsb(&b1), pos.ep_square());
+            {
+                Square from = pop_lsb(&b1);
+
+                // A legal en passant capture must not leave the king attacked,
+                // possibly along the rank emptied by the two pawns.
+                if (Type == LEGAL)
+                {
+                    Square capsq = pos.ep_square() - Up;
+                    Bitboard occupied = (pos.pieces() ^ from ^ capsq) | pos.ep_square();
+
+                    if (pos.attackers_to(ourKsq, occupied) & pos.pieces(Them) & ~square_bb(capsq))
+                        continue;
+                }
+
+                *moveList++ = make<EN_PASSANT>(from, pos.ep_square());
+            }
         }
     }
 
@@ -206,11 +245,51 @@ namespace {
   }
 
 
+  template<Color Us>
+  ExtMove* generate_legal_king_moves(const Position& pos, ExtMove* moveList) {
+
+    constexpr Color Them = ~Us;
+    const Square ksq = pos.square<KING>(Us);
+
+    // The king is removed from the occupancy, so that it cannot step back along
+    // the ray of a slider checking it.
+    Bitboard b = attacks_bb<KING>(ksq) & ~pos.pieces(Us);
+    while (b)
+    {
+        Square to = pop_lsb(&b);
+        if (!(pos.attackers_to(to, pos.pieces() ^ ksq) & pos.pieces(Them)))
+            *moveList++ = make_move(ksq, to);
+    }
+
+    if (pos.checkers() || !pos.can_castle(Us & ANY_CASTLING))
+        return moveList;
+
+    for (CastlingRights cr : { Us & KING_SIDE, Us & QUEEN_SIDE } )
+    {
+        if (pos.castling_impeded(cr) || !pos.can_castle(cr))
+            continue;
+
+        // The squares crossed by the king must not be attacked. In Chess960 the
+        // castling rook may also be the one blocking a check along the rank.
+        Square rfrom = pos.castling_rook_square(cr);
+        Square kto = relative_square(Us, cr & KING_SIDE ? SQ_G1 : SQ_C1);
+        Direction step = kto > ksq ? WEST : EAST;
+        bool attacked = false;
+
+        for (Square s = kto; s != ksq && !attacked; s += step)
+            attacked = pos.attackers_to(s) & pos.pieces(Them);
+
+        if (!attacked && (!pos.is_chess960() || !(pos.blockers_for_king(Us) & rfrom)))
+            *moveList++ = make<CASTLING>(ksq, rfrom);
+    }
+
+    return moveList;
+  }
+
+
   template<Color Us, GenType Type>
   ExtMove* generate_all(const Position& pos, ExtMove* moveList) {
 
-    static_assert(Type != LEGAL, "Unsupported type in generate_all()");
-
     constexpr bool Checks = Type == QUIET_CHECKS; // Reduce template instantiations
     Bitboard target, piecesToMove = pos.pieces(Us);
 
@@ -235,6 +314,23 @@ namespace {
         case NON_EVASIONS:
             target = ~pos.pieces(Us);
             break;
+        case LEGAL:
+        {
+            // The check mask: when in check, only the moves capturing the
+            // checker or blocking its ray, none at all in double check.
+            Bitboard checkers = pos.checkers();
+            target = !checkers               ? ~pos.pieces(Us)
+                   : more_than_one(checkers) ? Bitboard(0)
+                   : between_bb(pos.square<KING>(Us), lsb(checkers)) | checkers;
+
+            if (checkers)
+            {
+                moveList = generate_legal_king_moves<Us>(pos, moveList);
+                if (!target)
+                    return moveList;
+            }
+            break;
+        }
     }
 
     moveList = generate_pawn_moves<Us, Type>(pos, moveList, target);
@@ -243,7 +339,7 @@ namespace {
     moveList = generate_moves<Us,   ROOK, Checks>(pos, moveList, piecesToMove, target);
     moveList = generate_moves<Us,  QUEEN, Checks>(pos, moveList, piecesToMove, target);
 
-    if (Type != QUIET_CHECKS && Type != EVASIONS)
+    if (Type != QUIET_CHECKS && Type != EVASIONS && Type != LEGAL)
     {
         Square ksq = pos.square<KING>(Us);
         Bitboard b = attacks_bb<KING>(ksq) & target;
@@ -260,6 +356,9 @@ namespace {
                     *moveList++ = make<CASTLING>(ksq, pos.castling_rook_square(cr));
     }
 
+    if (Type == LEGAL && !pos.checkers())
+        moveList = generate_legal_king_moves<Us>(pos, moveList);
+
     return moveList;
   }
 
@@ -355,24 +454,15 @@ ExtMove* generate<EVASIONS>(const Position& pos, ExtMove* moveList) {
 }
 
 
-/// generate<LEGAL> generates all the legal moves in the given position
+/// generate<LEGAL> generates all the legal moves in the given position, with
+/// the check mask and the pins of StateInfo instead of filtering pseudo-legal
+/// moves with Position::legal().
 
 template<>
 ExtMove* generate<LEGAL>(const Position& pos, ExtMove* moveList) {
 
   Color us = pos.side_to_move();
-  Bitboard pinned = pos.blockers_for_king(us) & pos.pieces(us);
-  Square ksq = pos.square<KING>(us);
-  ExtMove* cur = moveList;
-
-  moveList = pos.checkers() ? generate<EVASIONS    >(pos, moveList)
-                            : generate<NON_EVASIONS>(pos, moveList);
-  while (cur != moveList)
-      if (  ((pinned && pinned & from_sq(*cur)) || from_sq(*cur) == ksq || type_of(*cur) == EN_PASSANT)
-          && !pos.legal(*cur))
-          *cur = (--moveList)->move;
-      else
-          ++cur;
-
-  return moveList;
+
+  return us == WHITE ? generate_all<WHITE, LEGAL>(pos, moveList)
+                     : generate_all<BLACK, LEGAL>(pos, moveList);
 }
@@ -20,6 +20,7 @@
 #define MOVEPICK_H_INCLUDED
 
 #include <array>
+#include <atomic>
 #include <limits>
 #include <type_traits>
 
@@ -52,6 +53,31 @@ public:
   }
 };
 
+/// StatsEntry of an atomic type is for the tables that may be shared by the
+/// threads, see the "History Sharing" option. The entries are read and written
+/// with relaxed atomics, and an update reads its entry once, so that the updates
+/// racing from other threads keep it in range even if some of them are lost.
+template<typename T, int D>
+class StatsEntry<std::atomic<T>, D> {
+
+  std::atomic<T> entry;
+
+public:
+  void operator=(const T& v) { entry.store(v, std::memory_order_relaxed); }
+  operator T() const { return entry.load(std::memory_order_relaxed); }
+
+  void operator<<(int bonus) {
+    assert(abs(bonus) <= D); // Ensure range is [-D, D]
+    static_assert(D <= std::numeric_limits<T>::max(), "D overflows T");
+
+    T e = entry.load(std::memory_order_relaxed);
+    e += bonus - e * abs(bonus) / D;
+    entry.store(e, std::memory_order_relaxed);
+
+    assert(abs(e) <= D);
+  }
+};
+
 /// Stats is a generic N-dimensional array used to store various statistics.
 /// The first template parameter T is the base type of the array, the second
 /// template parameter D limits the range of updates in [-D, D] when we update
@@ -100,11 +126,12 @@ typedef Stats<Move, NOT_USED, PIECE_NB, SQUARE_NB> CounterMoveHistory;
 typedef Stats<int16_t, 10692, PIECE_NB, SQUARE_NB, PIECE_TYPE_NB> CapturePieceToHistory;
 
 /// PieceToHistory is like ButterflyHistory but is addressed by a move's [piece][to]
-typedef Stats<int16_t, 29952, PIECE_NB, SQUARE_NB> PieceToHistory;
+typedef Stats<std::atomic<int16_t>, 29952, PIECE_NB, SQUARE_NB> PieceToHistory;
 
 /// ContinuationHistory is the combined history of a given pair of moves, usually
 /// the current one given a previous one. The nested history table is based on
-/// PieceToHistory instead of ButterflyBoards.
+/// PieceToHistory instead of ButterflyBoards. At 2 MB it is by far the largest
+/// history, so it is the one that the threads can share.
 typedef Stats<PieceToHistory, NOT_USED, PIECE_NB, SQUARE_NB> ContinuationHistory;
 
 
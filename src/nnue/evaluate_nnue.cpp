@@ -18,12 +18,29 @@
 
 // Code for calculating NNUE evaluation function
 
+#include <algorithm>
+#include <fstream>
 #include <iostream>
 #include <set>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#define WIN32_LEAN_AND_MEAN
+#ifndef NOMINMAX
+#  define NOMINMAX // Disable macros min() and max()
+#endif
+#include <windows.h>
+#endif
+
 #include "../evaluate.h"
 #include "../position.h"
 #include "../misc.h"
+#include "../movegen.h"
+#include "../thread.h"
 #include "../uci.h"
 #include "../types.h"
 
@@ -31,15 +48,16 @@
 
 namespace Eval::NNUE {
 
-  // Input feature converter
-  LargePagePtr<FeatureTransformer> feature_transformer;
-
-  // Evaluation function
-  AlignedPtr<Network> network;
+  // Current blob mapping, if any
+  void* blob_address;
+  std::uint64_t blob_mapping;
 
   // Evaluation function file name
   std::string fileName;
 
+  // Results of the evaluations timed by "bench eval", kept from being optimized away
+  volatile std::uint64_t benchmark_sink;
+
   namespace Detail {
 
   // Initialize the evaluation function parameters
@@ -68,13 +86,351 @@ namespace Eval::NNUE {
     return reference.ReadParameters(stream);
   }
 
+  // Time the forward propagation of a layer and of its input layers for "bench
+  // eval". A layer is charged with the time it adds to the propagation of its
+  // input, so the stages are listed from the input to the output.
+  template <typename Layer>
+  Stopwatch time_layers(const Layer& layer, const TransformedFeatureType* features,
+                        std::size_t stride, std::size_t count, int iterations,
+                        char* buffer, StageTimings& timings) {
+
+    constexpr bool kInputLayer = Layer::kBufferSize == 0;
+    Stopwatch input, watch;
+    std::uint64_t sum = 0;
+
+    if constexpr (!kInputLayer)
+        input = time_layers(layer.GetPreviousLayer(), features, stride, count,
+                            iterations, buffer + Layer::kSelfBufferSize, timings);
+
+    watch.start();
+    for (int it = 0; it < iterations; ++it)
+        for (std::size_t i = 0; i < count; ++i)
+            sum += layer.Propagate(features + i * stride, buffer)[0];
+    watch.stop(count * iterations);
+
+    if constexpr (!kInputLayer)
+    {
+        Stopwatch self = watch;
+        self.nanoseconds -= std::min(input.nanoseconds, self.nanoseconds);
+        self.cycles -= std::min(input.cycles, self.cycles);
+        timings.emplace_back(Layer::GetName(), self);
+    }
+
+    // Make sure the compiler keeps the propagations
+    benchmark_sink = sum;
+
+    return watch;
+  }
+
+  // Parameters and evaluation functions of one network architecture
+  template <typename Architecture>
+  struct Model {
+
+    using Transformer = FeatureTransformer<Architecture::kTransformedFeatureDimensions>;
+    using Network = typename Architecture::Network;
+
+    // Hash value of evaluation function structure
+    static constexpr std::uint32_t kHashValue =
+        Transformer::GetHashValue() ^ Network::GetHashValue();
+
+    // Parameters read from a .nnue file
+    static inline LargePagePtr<Transformer> feature_transformer;
+    static inline AlignedPtr<Network> network;
+
+    // Parameters used by the evaluation: either the two objects above or the
+    // read-only mapping of a blob written by export_blob()
+    static inline const Transformer* active_transformer;
+    static inline const Network* active_network;
+
+    static void release() {
+
+      feature_transformer.reset();
+      network.reset();
+      active_transformer = nullptr;
+      active_network = nullptr;
+    }
+
+    static bool read_parameters(std::istream& stream) {
+
+      Initialize(feature_transformer);
+      Initialize(network);
+      active_transformer = feature_transformer.get();
+      active_network = network.get();
+
+      if (!ReadParameters(stream, *feature_transformer)) return false;
+      if (!ReadParameters(stream, *network)) return false;
+      return stream && stream.peek() == std::ios::traits_type::eof();
+    }
+
+    static void use_mapped(const char* transformer, const char* network) {
+
+      release();
+      active_transformer = reinterpret_cast<const Transformer*>(transformer);
+      active_network = reinterpret_cast<const Network*>(network);
+    }
+
+    static const void* transformer() { return active_transformer; }
+    static const void* net() { return active_network; }
+
+    static Value evaluate(const Position& pos) {
+
+      // We manually align the arrays on the stack because with gcc < 9.3
+      // overaligning stack variables with alignas() doesn't work correctly.
+
+      constexpr uint64_t alignment = kCacheLineSize;
+
+#if defined(ALIGNAS_ON_STACK_VARIABLES_BROKEN)
+      TransformedFeatureType transformed_features_unaligned[
+        Transformer::kBufferSize + alignment / sizeof(TransformedFeatureType)];
+      char buffer_unaligned[Network::kBufferSize + alignment];
+
+      auto* transformed_features = align_ptr_up<alignment>(&transformed_features_unaligned[0]);
+      auto* buffer = align_ptr_up<alignment>(&buffer_unaligned[0]);
+#else
+      alignas(alignment)
+        TransformedFeatureType transformed_features[Transformer::kBufferSize];
+      alignas(alignment) char buffer[Network::kBufferSize];
+#endif
+
+      ASSERT_ALIGNED(transformed_features, alignment);
+      ASSERT_ALIGNED(buffer, alignment);
+
+      active_transformer->Transform(pos, transformed_features,
+                                    pos.this_thread()->refreshTable);
+      const auto output = active_network->Propagate(transformed_features, buffer);
+
+      return static_cast<Value>(output[0] / FV_SCALE);
+    }
+
+    // The feature transforms are done first for a group of positions and the
+    // network is then run on the group one layer at a time, so that the
+    // weights of each dense layer are loaded once per group.
+    static void evaluate_batch(const Position* const positions[], std::size_t count, Value values[]) {
+
+      constexpr uint64_t alignment = kCacheLineSize;
+      constexpr std::size_t kBatchSize = 32;
+
+#if defined(ALIGNAS_ON_STACK_VARIABLES_BROKEN)
+      TransformedFeatureType transformed_features_unaligned[
+        kBatchSize * Transformer::kBufferSize + alignment / sizeof(TransformedFeatureType)];
+      char buffer_unaligned[kBatchSize * Network::kBufferSize + alignment];
+
+      auto* transformed_features = align_ptr_up<alignment>(&transformed_features_unaligned[0]);
+      auto* buffer = align_ptr_up<alignment>(&buffer_unaligned[0]);
+#else
+      alignas(alignment)
+        TransformedFeatureType transformed_features[kBatchSize * Transformer::kBufferSize];
+      alignas(alignment) char buffer[kBatchSize * Network::kBufferSize];
+#endif
+
+      ASSERT_ALIGNED(transformed_features, alignment);
+      ASSERT_ALIGNED(buffer, alignment);
+
+      for (std::size_t first = 0; first < count; first += kBatchSize)
+      {
+          const std::size_t n = std::min(kBatchSize, count - first);
+
+          for (std::size_t i = 0; i < n; ++i)
+          {
+              const Position& pos = *positions[first + i];
+              active_transformer->Transform(pos, &transformed_features[i * Transformer::kBufferSize],
+                                            pos.this_thread()->refreshTable);
+          }
+
+          const auto output = active_network->PropagateBatch(
+              transformed_features, Transformer::kBufferSize, n, buffer);
+          const std::size_t stride = Network::BatchStride(Transformer::kBufferSize);
+
+          for (std::size_t i = 0; i < n; ++i)
+              values[first + i] = static_cast<Value>(output[i * stride] / FV_SCALE);
+      }
+    }
+
+    // Time the stages of evaluate() for "bench eval": the extraction of the
+    // active features, the refresh and the incremental update of the
+    // accumulators, the output of the feature transformer and each layer of
+    // the network. The accumulator stages do not include the output, which is
+    // timed on its own with accumulators already computed.
+    static void benchmark(Position* const positions[], std::size_t count, int iterations,
+                          StageTimings& timings) {
+
+      constexpr std::size_t kStride = Transformer::kBufferSize;
+      const std::uint64_t calls = count * iterations;
+
+      // One slot per position, and a last one for the positions after a move
+      std::vector<TransformedFeatureType> features_unaligned(
+          (count + 1) * kStride + kCacheLineSize / sizeof(TransformedFeatureType));
+      std::vector<char> buffer_unaligned(Network::kBufferSize + kCacheLineSize);
+
+      auto* features = align_ptr_up<kCacheLineSize>(features_unaligned.data());
+      auto* buffer = align_ptr_up<kCacheLineSize>(buffer_unaligned.data());
+      auto* scratch = features + count * kStride;
+
+      Stopwatch extraction, refresh, cachedRefresh, update, output;
+      std::uint64_t sum = 0;
+
+      extraction.start();
+      for (int it = 0; it < iterations; ++it)
+          for (std::size_t i = 0; i < count; ++i)
+              for (Color c : { WHITE, BLACK })
+              {
+                  Features::IndexList active;
+                  Features::HalfKP<Features::Side::kFriend>::AppendActiveIndices(
+                      *positions[i], c, &active);
+                  for (IndexType index : active)
+                      sum += index;
+              }
+      extraction.stop(calls);
+
+      // Positions set from a FEN have no parent, so that clearing the state of
+      // their accumulators forces a refresh. Invalidating the refresh table
+      // entry as well makes it a refresh from the biases.
+      for (bool cached : { false, true })
+      {
+          Stopwatch& watch = cached ? cachedRefresh : refresh;
+          watch.start();
+          for (int it = 0; it < iterations; ++it)
+              for (std::size_t i = 0; i < count; ++i)
+              {
+                  Position& pos = *positions[i];
+                  RefreshTable& table = pos.this_thread()->refreshTable;
+
+                  for (Color c : { WHITE, BLACK })
+                  {
+                      pos.state()->accumulator.state[c] = INIT;
+                      if (!cached)
+                          table.entries[pos.square<KING>(c)][c].computed = false;
+                  }
+                  active_transformer->Transform(pos, features + i * kStride, table);
+              }
+          watch.stop(calls);
+      }
+
+      output.start();
+      for (int it = 0; it < iterations; ++it)
+          for (std::size_t i = 0; i < count; ++i)
+              active_transformer->Transform(*positions[i], features + i * kStride,
+                                            positions[i]->this_thread()->refreshTable);
+      output.stop(calls);
+
+      // Update from the computed accumulator of the parent, skipping the king
+      // moves that need a refresh.
+      StateInfo st;
+      for (std::size_t i = 0; i < count; ++i)
+      {
+          Position& pos = *positions[i];
+          RefreshTable& table = pos.this_thread()->refreshTable;
+
+          for (const auto& m : MoveList<LEGAL>(pos))
+          {
+              if (type_of(pos.moved_piece(m)) == KING)
+                  continue;
+
+              pos.do_move(m, st);
+              update.start();
+              for (int it = 0; it < iterations; ++it)
+              {
+                  pos.state()->accumulator.state[WHITE] = EMPTY;
+                  pos.state()->accumulator.state[BLACK] = EMPTY;
+                  active_transformer->Transform(pos, scratch, table);
+              }
+              update.stop(iterations);
+              pos.undo_move(m);
+          }
+      }
+
+      // Remove the time of the transformer output from the accumulator stages
+      for (Stopwatch* watch : { &refresh, &cachedRefresh, &update })
+      {
+          watch->nanoseconds -= std::min(watch->nanoseconds, output.nanoseconds * watch->calls / output.calls);
+          watch->cycles -= std::min(watch->cycles, output.cycles * watch->calls / output.calls);
+      }
+
+      timings.emplace_back("HalfKP active features", extraction);
+      timings.emplace_back("Accumulator refresh", refresh);
+      timings.emplace_back("Accumulator refresh (cache)", cachedRefresh);
+      timings.emplace_back("Accumulator update", update);
+      timings.emplace_back("Transformer output", output);
+
+      time_layers(*active_network, features, kStride, count, iterations, buffer, timings);
+
+      benchmark_sink = sum;
+    }
+  };
+
   }  // namespace Detail
 
-  // Initialize the evaluation function parameters
-  void Initialize() {
+  // Dispatch table entry of a network architecture. The architecture of a
+  // network is identified by the hash value in the header of its file.
+  struct Architecture {
+    std::uint32_t hashValue;
+    std::size_t transformerSize, networkSize;
+    bool (*read_parameters)(std::istream&);
+    void (*use_mapped)(const char*, const char*);
+    void (*release)();
+    const void* (*transformer)();
+    const void* (*network)();
+    Value (*evaluate)(const Position&);
+    void (*evaluate_batch)(const Position* const[], std::size_t, Value[]);
+    void (*benchmark)(Position* const[], std::size_t, int, StageTimings&);
+  };
 
-    Detail::Initialize(feature_transformer);
-    Detail::Initialize(network);
+  template <typename T>
+  constexpr Architecture make_architecture() {
+
+    using M = Detail::Model<T>;
+    return { M::kHashValue, sizeof(typename M::Transformer), sizeof(typename M::Network),
+             M::read_parameters, M::use_mapped, M::release, M::transformer, M::net,
+             M::evaluate, M::evaluate_batch, M::benchmark };
+  }
+
+  // Architectures compiled in, the first one is the default
+  constexpr Architecture Architectures[] = {
+    make_architecture<HalfKP_256x2_32_32>(),
+    make_architecture<HalfKP_128x2_32_32>()
+  };
+
+  // Architecture of the loaded network
+  const Architecture* active_architecture;
+
+  const Architecture* find_architecture(std::uint32_t hash_value) {
+
+    for (const Architecture& arch : Architectures)
+        if (arch.hashValue == hash_value)
+            return &arch;
+
+    return nullptr;
+  }
+
+  // Release the current blob mapping, if any
+  void unmap_blob() {
+
+    if (!blob_address)
+        return;
+
+#ifndef _WIN32
+    munmap(blob_address, blob_mapping);
+#else
+    UnmapViewOfFile(blob_address);
+    CloseHandle((HANDLE)blob_mapping);
+#endif
+    blob_address = nullptr;
+  }
+
+  // Release the parameters of all the architectures
+  void release() {
+
+    unmap_blob();
+    for (const Architecture& arch : Architectures)
+        arch.release();
+    active_architecture = nullptr;
+  }
+
+  // Cached accumulators were computed with the previous weights
+  void clear_thread_caches() {
+
+    for (Thread* th : Threads)
+        th->refreshTable.clear();
   }
 
   // Read network header
@@ -91,54 +447,192 @@ namespace Eval::NNUE {
     return !stream.fail();
   }
 
-  // Read network parameters
+  // Read network parameters, for the architecture given by the header
   bool ReadParameters(std::istream& stream) {
 
     std::uint32_t hash_value;
     std::string architecture;
     if (!ReadHeader(stream, &hash_value, &architecture)) return false;
-    if (hash_value != kHashValue) return false;
-    if (!Detail::ReadParameters(stream, *feature_transformer)) return false;
-    if (!Detail::ReadParameters(stream, *network)) return false;
-    return stream && stream.peek() == std::ios::traits_type::eof();
+
+    const Architecture* arch = find_architecture(hash_value);
+    if (!arch) return false;
+
+    active_architecture = arch;
+    return arch->read_parameters(stream);
   }
 
   // Evaluation function. Perform differential calculation.
   Value evaluate(const Position& pos) {
 
-    // We manually align the arrays on the stack because with gcc < 9.3
-    // overaligning stack variables with alignas() doesn't work correctly.
+    return active_architecture->evaluate(pos);
+  }
 
-    constexpr uint64_t alignment = kCacheLineSize;
+  // Evaluate a batch of positions
+  void evaluate(const Position* const positions[], std::size_t count, Value values[]) {
 
-#if defined(ALIGNAS_ON_STACK_VARIABLES_BROKEN)
-    TransformedFeatureType transformed_features_unaligned[
-      FeatureTransformer::kBufferSize + alignment / sizeof(TransformedFeatureType)];
-    char buffer_unaligned[Network::kBufferSize + alignment];
-
-    auto* transformed_features = align_ptr_up<alignment>(&transformed_features_unaligned[0]);
-    auto* buffer = align_ptr_up<alignment>(&buffer_unaligned[0]);
-#else
-    alignas(alignment)
-      TransformedFeatureType transformed_features[FeatureTransformer::kBufferSize];
-    alignas(alignment) char buffer[Network::kBufferSize];
-#endif
-
-    ASSERT_ALIGNED(transformed_features, alignment);
-    ASSERT_ALIGNED(buffer, alignment);
+    active_architecture->evaluate_batch(positions, count, values);
+  }
 
-    feature_transformer->Transform(pos, transformed_features);
-    const auto output = network->Propagate(transformed_features, buffer);
+  // Time the stages of the evaluation, for "bench eval"
+  void benchmark(Position* const positions[], std::size_t count, int iterations, StageTimings& timings) {
 
-    return static_cast<Value>(output[0] / FV_SCALE);
+    active_architecture->benchmark(positions, count, iterations, timings);
   }
 
   // Load eval, from a file stream or a memory stream
   bool load_eval(std::string name, std::istream& stream) {
 
-    Initialize();
+    release();
     fileName = name;
+    clear_thread_caches();
+
     return ReadParameters(stream);
   }
 
+  // A blob stores the parameters exactly as they are laid out in memory by this
+  // build, i.e. after the weight permutation and the saturation fixes done while
+  // reading a .nnue file. The header fills the first page and both objects start
+  // on a page boundary, so that the mapping can be used without any copy.
+  struct BlobHeader {
+    std::uint32_t magic, version, hashValue, layout;
+    std::uint64_t transformerOffset, transformerSize;
+    std::uint64_t networkOffset, networkSize;
+  };
+
+  constexpr std::uint32_t kBlobMagic = 0x424E4E53u;
+  constexpr std::uint64_t kBlobPageSize = 4096;
+
+  // Build options that change the in-memory layout of the parameters. The byte
+  // order is covered by the magic number.
+  std::uint32_t blob_layout() {
+
+    std::uint32_t layout = 0;
+#if defined(USE_SSSE3)
+    layout |= 1 << 1; // Permuted affine weights with saturation fixes
+#endif
+#if defined(USE_VNNI)
+    layout |= 1 << 2; // No saturation fixes
+#endif
+    return layout;
+  }
+
+  BlobHeader blob_header(const Architecture& arch) {
+
+    BlobHeader header;
+    header.magic = kBlobMagic;
+    header.version = kVersion;
+    header.hashValue = arch.hashValue;
+    header.layout = blob_layout();
+    header.transformerOffset = kBlobPageSize;
+    header.transformerSize = arch.transformerSize;
+    header.networkOffset = CeilToMultiple<std::uint64_t>(kBlobPageSize + arch.transformerSize, kBlobPageSize);
+    header.networkSize = arch.networkSize;
+    return header;
+  }
+
+  // Write the parameters in use as a blob that can be mapped by map_blob()
+  bool export_blob(const std::string& name) {
+
+    if (!active_architecture)
+        return false;
+
+    std::ofstream stream(name, std::ios::binary);
+    const BlobHeader header = blob_header(*active_architecture);
+    const std::string padding(kBlobPageSize, '\0');
+
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(padding.data(), header.transformerOffset - sizeof(header));
+    stream.write(reinterpret_cast<const char*>(active_architecture->transformer()), header.transformerSize);
+    stream.write(padding.data(), header.networkOffset - header.transformerOffset - header.transformerSize);
+    stream.write(reinterpret_cast<const char*>(active_architecture->network()), header.networkSize);
+    return !stream.fail();
+  }
+
+  // Map a blob read-only and use its parameters in place. Returns false if the
+  // file is not a blob written by a build with the same parameter layout.
+  bool map_blob(const std::string& name) {
+
+    void* address;
+    std::uint64_t mapping, size;
+
+#ifndef _WIN32
+    struct stat statbuf;
+    int fd = ::open(name.c_str(), O_RDONLY);
+
+    if (fd == -1)
+        return false;
+
+    if (fstat(fd, &statbuf) == -1 || std::uint64_t(statbuf.st_size) < sizeof(BlobHeader))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    size = mapping = statbuf.st_size;
+
+    address = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (address == MAP_FAILED)
+        return false;
+#else
+    HANDLE fd = CreateFile(name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (fd == INVALID_HANDLE_VALUE)
+        return false;
+
+    DWORD size_high;
+    DWORD size_low = GetFileSize(fd, &size_high);
+    size = (std::uint64_t(size_high) << 32) | size_low;
+
+    HANDLE mmap = size >= sizeof(BlobHeader) ? CreateFileMapping(fd, nullptr, PAGE_READONLY, size_high, size_low, nullptr)
+                                             : nullptr;
+    CloseHandle(fd);
+
+    if (!mmap)
+        return false;
+
+    mapping = (std::uint64_t)mmap;
+    address = MapViewOfFile(mmap, FILE_MAP_READ, 0, 0, 0);
+
+    if (!address)
+    {
+        CloseHandle(mmap);
+        return false;
+    }
+#endif
+
+    BlobHeader header, expected;
+    std::memcpy(&header, address, sizeof(header));
+    const Architecture* arch = find_architecture(header.hashValue);
+
+    if (arch)
+        expected = blob_header(*arch);
+
+    if (   !arch
+        || std::memcmp(&header, &expected, sizeof(header))
+        || size < header.networkOffset + header.networkSize)
+    {
+#ifndef _WIN32
+        munmap(address, mapping);
+#else
+        UnmapViewOfFile(address);
+        CloseHandle((HANDLE)mapping);
+#endif
+        return false;
+    }
+
+    release();
+    blob_address = address;
+    blob_mapping = mapping;
+    active_architecture = arch;
+    arch->use_mapped(static_cast<const char*>(address) + header.transformerOffset,
+                     static_cast<const char*>(address) + header.networkOffset);
+    fileName = name;
+    clear_thread_caches();
+
+    return true;
+  }
+
 } // namespace Eval::NNUE
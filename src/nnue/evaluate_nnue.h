@@ -27,10 +27,6 @@
 
 namespace Eval::NNUE {
 
-  // Hash value of evaluation function structure
-  constexpr std::uint32_t kHashValue =
-      FeatureTransformer::GetHashValue() ^ Network::GetHashValue();
-
   // Deleter for automating release of memory area
   template <typename T>
   struct AlignedDeleter {
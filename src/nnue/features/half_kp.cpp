@@ -63,6 +63,28 @@ namespace Eval::NNUE::Features {
     }
   }
 
+  // Get a list of indices for features that differ from a given piece placement
+  template <Side AssociatedKing>
+  void HalfKP<AssociatedKing>::AppendChangedIndices(
+      const Position& pos, const Bitboard* byColorBB, const Bitboard* byTypeBB,
+      Color perspective, IndexList* removed, IndexList* added) {
+
+    Square ksq = orient(perspective, pos.square<KING>(perspective));
+    for (Color c : { WHITE, BLACK })
+        for (PieceType pt = PAWN; pt < KING; ++pt)
+        {
+            Piece pc = make_piece(c, pt);
+            Bitboard oldBB = byColorBB[c] & byTypeBB[pt];
+            Bitboard newBB = pos.pieces(c, pt);
+            Bitboard bb = oldBB & ~newBB;
+            while (bb)
+                removed->push_back(make_index(perspective, pop_lsb(&bb), pc, ksq));
+            bb = newBB & ~oldBB;
+            while (bb)
+                added->push_back(make_index(perspective, pop_lsb(&bb), pc, ksq));
+        }
+  }
+
   template class HalfKP<Side::kFriend>;
 
 }  // namespace Eval::NNUE::Features
@@ -52,6 +52,11 @@ namespace Eval::NNUE::Features {
     // Get a list of indices for recently changed features
     static void AppendChangedIndices(const Position& pos, const DirtyPiece& dp, Color perspective,
                                      IndexList* removed, IndexList* added);
+
+    // Get a list of indices for features that differ from a given piece placement
+    static void AppendChangedIndices(const Position& pos, const Bitboard* byColorBB,
+                                     const Bitboard* byTypeBB, Color perspective,
+                                     IndexList* removed, IndexList* added);
   };
 
 }  // namespace Eval::NNUE::Features
@@ -22,7 +22,9 @@
 #define NNUE_LAYERS_AFFINE_TRANSFORM_H_INCLUDED
 
 #include <iostream>
+#include <string>
 #include "../nnue_common.h"
+#include "../../bitboard.h"
 
 namespace Eval::NNUE::Layers {
 
@@ -47,6 +49,23 @@ namespace Eval::NNUE::Layers {
     static constexpr const IndexType kOutputSimdWidth = kSimdWidth / 4;
 #endif
 
+    // The input of a wide layer is the clipped output of the feature transformer,
+    // which is mostly zero. With AVX2 and better we find the non-zero groups of
+    // four inputs and only accumulate their weight columns.
+#if defined (USE_AVX2)
+    static constexpr bool kSparseInput = kInputDimensions >= 512 && kOutputDimensions > 1;
+
+    // Without VNNI a sparse group costs about a third more than a dense one,
+    // so we fall back to the dense loop when too few groups are zero.
+#if defined (USE_VNNI)
+    static constexpr IndexType kMaxSparseChunks = kSparseInput ? kPaddedInputDimensions / 4 * 7 / 8 : 0;
+#else
+    static constexpr IndexType kMaxSparseChunks = kSparseInput ? kPaddedInputDimensions / 4 * 3 / 4 : 0;
+#endif
+#else
+    static constexpr bool kSparseInput = false;
+#endif
+
     // Size of forward propagation buffer used in this layer
     static constexpr std::size_t kSelfBufferSize =
         CeilToMultiple(kOutputDimensions * sizeof(OutputType), kCacheLineSize);
@@ -64,6 +83,16 @@ namespace Eval::NNUE::Layers {
       return hash_value;
     }
 
+    // Name of the layer, used by "bench eval"
+    static std::string GetName() {
+      return "AffineTransform " + std::to_string(kInputDimensions)
+           + "->" + std::to_string(kOutputDimensions);
+    }
+
+    const PreviousLayer& GetPreviousLayer() const {
+      return previous_layer_;
+    }
+
    // Read network parameters
     bool ReadParameters(std::istream& stream) {
       if (!previous_layer_.ReadParameters(stream)) return false;
@@ -130,6 +159,32 @@ namespace Eval::NNUE::Layers {
         const TransformedFeatureType* transformed_features, char* buffer) const {
       const auto input = previous_layer_.Propagate(
           transformed_features, buffer + kSelfBufferSize);
+      return PropagateLayer(input, buffer);
+    }
+
+    // Forward propagation of a batch of positions, whose transformed features
+    // are stride apart. Each layer is run on the whole batch before the next
+    // one, and writes its outputs kSelfBufferSize apart, so that count times
+    // kBufferSize bytes of buffer are used.
+    const OutputType* PropagateBatch(
+        const TransformedFeatureType* transformed_features, std::size_t stride,
+        std::size_t count, char* buffer) const {
+      const auto input = previous_layer_.PropagateBatch(
+          transformed_features, stride, count, buffer + count * kSelfBufferSize);
+      const std::size_t input_stride = PreviousLayer::BatchStride(stride);
+      for (std::size_t i = 0; i < count; ++i)
+        PropagateLayer(input + i * input_stride, buffer + i * kSelfBufferSize);
+      return reinterpret_cast<const OutputType*>(buffer);
+    }
+
+    // Distance between the outputs of two positions of a batch
+    static constexpr std::size_t BatchStride(std::size_t /*stride*/) {
+      return kSelfBufferSize / sizeof(OutputType);
+    }
+
+   private:
+    // Forward propagation of this layer alone, writing its output to buffer
+    const OutputType* PropagateLayer(const InputType* input, char* buffer) const {
 
 #if defined (USE_AVX512)
 
@@ -281,20 +336,77 @@ namespace Eval::NNUE::Layers {
 
           const auto input32 = reinterpret_cast<const std::int32_t*>(input);
           vec_t* outptr = reinterpret_cast<vec_t*>(output);
-          std::memcpy(output, biases_, kOutputDimensions * sizeof(OutputType));
 
-          for (int i = 0; i < (int)kNumChunks - 3; i += 4)
+#if defined (USE_AVX2)
+          constexpr IndexType kMaskWords = (kNumChunks + 63) / 64;
+          Bitboard nnz[kMaskWords] = {};
+          IndexType count = kNumChunks;
+
+          if constexpr (kSparseInput)
+          {
+              constexpr IndexType kChunksPerVec = sizeof(vec_t) / 4;
+              const vec_t kZero = vec_setzero();
+
+              // Inputs are in [0, 127], so a group of four is non-zero exactly
+              // when it compares greater than zero as a signed 32 bit integer.
+              for (IndexType i = 0; i < kNumChunks / kChunksPerVec; ++i)
+              {
+#if defined (USE_AVX512)
+                  Bitboard mask = _mm512_cmpgt_epi32_mask(input_vector[i], kZero);
+#else
+                  Bitboard mask = _mm256_movemask_ps(_mm256_castsi256_ps(
+                                      _mm256_cmpgt_epi32(input_vector[i], kZero)));
+#endif
+                  nnz[i * kChunksPerVec / 64] |= mask << (i * kChunksPerVec % 64);
+              }
+
+              count = 0;
+              for (IndexType w = 0; w < kMaskWords; ++w)
+                  count += popcount(nnz[w]);
+          }
+
+          if (count < kMaxSparseChunks)
+          {
+              constexpr IndexType kNumRegs = kOutputDimensions / kOutputSimdWidth;
+
+              // A single dpbusd per group cannot saturate, so the sums are exact
+              // and match the dense path once the canSaturate16 terms are added.
+              vec_t acc[kNumRegs];
+              const auto biasvec = reinterpret_cast<const vec_t*>(biases_);
+              for (IndexType k = 0; k < kNumRegs; ++k)
+                  acc[k] = biasvec[k];
+
+              for (IndexType w = 0; w < kMaskWords; ++w)
+                  while (nnz[w])
+                  {
+                      const IndexType i = w * 64 + pop_lsb(&nnz[w]);
+                      const vec_t in = vec_set_32(input32[i]);
+                      const auto col = reinterpret_cast<const vec_t*>(&weights_[i * kOutputDimensions * 4]);
+                      for (IndexType k = 0; k < kNumRegs; ++k)
+                          vec_add_dpbusd_32(acc[k], in, col[k]);
+                  }
+
+              for (IndexType k = 0; k < kNumRegs; ++k)
+                  outptr[k] = acc[k];
+          }
+          else
+#endif
           {
-              const vec_t in0 = vec_set_32(input32[i + 0]);
-              const vec_t in1 = vec_set_32(input32[i + 1]);
-              const vec_t in2 = vec_set_32(input32[i + 2]);
-              const vec_t in3 = vec_set_32(input32[i + 3]);
-              const auto col0 = reinterpret_cast<const vec_t*>(&weights_[(i + 0) * kOutputDimensions * 4]);
-              const auto col1 = reinterpret_cast<const vec_t*>(&weights_[(i + 1) * kOutputDimensions * 4]);
-              const auto col2 = reinterpret_cast<const vec_t*>(&weights_[(i + 2) * kOutputDimensions * 4]);
-              const auto col3 = reinterpret_cast<const vec_t*>(&weights_[(i + 3) * kOutputDimensions * 4]);
-              for (int j = 0; j * kOutputSimdWidth < kOutputDimensions; ++j)
-                  vec_add_dpbusd_32x4(outptr[j], in0, col0[j], in1, col1[j], in2, col2[j], in3, col3[j]);
+              std::memcpy(output, biases_, kOutputDimensions * sizeof(OutputType));
+
+              for (int i = 0; i < (int)kNumChunks - 3; i += 4)
+              {
+                  const vec_t in0 = vec_set_32(input32[i + 0]);
+                  const vec_t in1 = vec_set_32(input32[i + 1]);
+                  const vec_t in2 = vec_set_32(input32[i + 2]);
+                  const vec_t in3 = vec_set_32(input32[i + 3]);
+                  const auto col0 = reinterpret_cast<const vec_t*>(&weights_[(i + 0) * kOutputDimensions * 4]);
+                  const auto col1 = reinterpret_cast<const vec_t*>(&weights_[(i + 1) * kOutputDimensions * 4]);
+                  const auto col2 = reinterpret_cast<const vec_t*>(&weights_[(i + 2) * kOutputDimensions * 4]);
+                  const auto col3 = reinterpret_cast<const vec_t*>(&weights_[(i + 3) * kOutputDimensions * 4]);
+                  for (int j = 0; j * kOutputSimdWidth < kOutputDimensions; ++j)
+                      vec_add_dpbusd_32x4(outptr[j], in0, col0[j], in1, col1[j], in2, col2[j], in3, col3[j]);
+              }
           }
           for (int i = 0; i < canSaturate16.count; ++i)
               output[canSaturate16.ids[i].out] += input[canSaturate16.ids[i].in] * canSaturate16.ids[i].w;
@@ -432,7 +544,6 @@ namespace Eval::NNUE::Layers {
       return output;
     }
 
-   private:
     using BiasType = OutputType;
     using WeightType = std::int8_t;
 
@@ -21,6 +21,8 @@
 #ifndef NNUE_LAYERS_CLIPPED_RELU_H_INCLUDED
 #define NNUE_LAYERS_CLIPPED_RELU_H_INCLUDED
 
+#include <string>
+
 #include "../nnue_common.h"
 
 namespace Eval::NNUE::Layers {
@@ -54,6 +56,15 @@ namespace Eval::NNUE::Layers {
       return hash_value;
     }
 
+    // Name of the layer, used by "bench eval"
+    static std::string GetName() {
+      return "ClippedReLU " + std::to_string(kOutputDimensions);
+    }
+
+    const PreviousLayer& GetPreviousLayer() const {
+      return previous_layer_;
+    }
+
     // Read network parameters
     bool ReadParameters(std::istream& stream) {
       return previous_layer_.ReadParameters(stream);
@@ -64,6 +75,32 @@ namespace Eval::NNUE::Layers {
         const TransformedFeatureType* transformed_features, char* buffer) const {
       const auto input = previous_layer_.Propagate(
           transformed_features, buffer + kSelfBufferSize);
+      return PropagateLayer(input, buffer);
+    }
+
+    // Forward propagation of a batch of positions, whose transformed features
+    // are stride apart. Each layer is run on the whole batch before the next
+    // one, and writes its outputs kSelfBufferSize apart, so that count times
+    // kBufferSize bytes of buffer are used.
+    const OutputType* PropagateBatch(
+        const TransformedFeatureType* transformed_features, std::size_t stride,
+        std::size_t count, char* buffer) const {
+      const auto input = previous_layer_.PropagateBatch(
+          transformed_features, stride, count, buffer + count * kSelfBufferSize);
+      const std::size_t input_stride = PreviousLayer::BatchStride(stride);
+      for (std::size_t i = 0; i < count; ++i)
+        PropagateLayer(input + i * input_stride, buffer + i * kSelfBufferSize);
+      return reinterpret_cast<const OutputType*>(buffer);
+    }
+
+    // Distance between the outputs of two positions of a batch
+    static constexpr std::size_t BatchStride(std::size_t /*stride*/) {
+      return kSelfBufferSize / sizeof(OutputType);
+    }
+
+   private:
+    // Forward propagation of this layer alone, writing its output to buffer
+    const OutputType* PropagateLayer(const InputType* input, char* buffer) const {
       const auto output = reinterpret_cast<OutputType*>(buffer);
 
   #if defined(USE_AVX2)
@@ -157,7 +194,6 @@ namespace Eval::NNUE::Layers {
       return output;
     }
 
-   private:
     PreviousLayer previous_layer_;
   };
 
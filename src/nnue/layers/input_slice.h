@@ -60,6 +60,18 @@ class InputSlice {
     return transformed_features + Offset;
   }
 
+  // Forward propagation of a batch of positions
+  const OutputType* PropagateBatch(
+      const TransformedFeatureType* transformed_features, std::size_t /*stride*/,
+      std::size_t /*count*/, char* /*buffer*/) const {
+    return transformed_features + Offset;
+  }
+
+  // Distance between the outputs of two positions of a batch
+  static constexpr std::size_t BatchStride(std::size_t stride) {
+    return stride;
+  }
+
  private:
 };
 
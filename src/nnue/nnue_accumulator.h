@@ -31,10 +31,37 @@ namespace Eval::NNUE {
   // Class that holds the result of affine transformation of input features
   struct alignas(kCacheLineSize) Accumulator {
     std::int16_t
-        accumulation[2][kRefreshTriggers.size()][kTransformedFeatureDimensions];
+        accumulation[2][kRefreshTriggers.size()][kMaxTransformedFeatureDimensions];
     AccumulatorState state[2];
   };
 
+  // Per-thread cache used to speed up accumulator refreshes. For each king
+  // square and perspective it keeps the accumulator of the last refresh
+  // together with the piece placement it was computed for, so that a new
+  // refresh only has to apply the features that differ from that board.
+  struct RefreshTable {
+
+    struct alignas(kCacheLineSize) Entry {
+      std::int16_t accumulation[kMaxTransformedFeatureDimensions];
+      Bitboard byColorBB[COLOR_NB];
+      Bitboard byTypeBB[PIECE_TYPE_NB];
+      bool computed;
+    };
+
+    // Invalidate all the entries, e.g. after a new network has been loaded
+    void clear() {
+      for (auto& perSquare : entries)
+          for (Entry& e : perSquare)
+              e.computed = false;
+      refreshes = cachedRefreshes = updates = updatedPlies = 0;
+    }
+
+    Entry entries[SQUARE_NB][COLOR_NB];
+
+    // How this thread brought its accumulators up to date, reported by bench
+    std::uint64_t refreshes, cachedRefreshes, updates, updatedPlies;
+  };
+
 }  // namespace Eval::NNUE
 
 #endif // NNUE_ACCUMULATOR_H_INCLUDED
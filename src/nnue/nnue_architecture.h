@@ -21,14 +21,36 @@
 #ifndef NNUE_ARCHITECTURE_H_INCLUDED
 #define NNUE_ARCHITECTURE_H_INCLUDED
 
-// Defines the network structure
+#include <algorithm>
+
+// Defines the network structures. The one in use is selected at load time from
+// the hash value in the header of the network file.
 #include "architectures/halfkp_256x2-32-32.h"
+#include "architectures/halfkp_128x2-32-32.h"
 
 namespace Eval::NNUE {
 
-  static_assert(kTransformedFeatureDimensions % kMaxSimdWidth == 0, "");
-  static_assert(Network::kOutputDimensions == 1, "");
-  static_assert(std::is_same<Network::OutputType, std::int32_t>::value, "");
+  // Input features used in evaluation function
+  using RawFeatures = Features::FeatureSet<
+      Features::HalfKP<Features::Side::kFriend>>;
+
+  // Accumulators are sized for the largest number of transformed features
+  constexpr IndexType kMaxTransformedFeatureDimensions = std::max(
+      HalfKP_256x2_32_32::kTransformedFeatureDimensions,
+      HalfKP_128x2_32_32::kTransformedFeatureDimensions);
+
+  template <typename Architecture>
+  constexpr bool IsValidArchitecture() {
+    using Network = typename Architecture::Network;
+    static_assert(Architecture::kTransformedFeatureDimensions % kMaxSimdWidth == 0, "");
+    static_assert(Architecture::kTransformedFeatureDimensions <= kMaxTransformedFeatureDimensions, "");
+    static_assert(Network::kOutputDimensions == 1, "");
+    static_assert(std::is_same<typename Network::OutputType, std::int32_t>::value, "");
+    return true;
+  }
+
+  static_assert(IsValidArchitecture<HalfKP_256x2_32_32>());
+  static_assert(IsValidArchitecture<HalfKP_128x2_32_32>());
 
   // Trigger for full calculation instead of difference calculation
   constexpr auto kRefreshTriggers = RawFeatures::kRefreshTriggers;
@@ -23,8 +23,10 @@
 
 #include "nnue_common.h"
 #include "nnue_architecture.h"
+#include "nnue_accumulator.h"
 #include "features/index_list.h"
 
+#include <algorithm>
 #include <cstring> // std::memset()
 
 namespace Eval::NNUE {
@@ -40,7 +42,7 @@ namespace Eval::NNUE {
   #define vec_store(a,b) _mm512_store_si512(a,b)
   #define vec_add_16(a,b) _mm512_add_epi16(a,b)
   #define vec_sub_16(a,b) _mm512_sub_epi16(a,b)
-  static constexpr IndexType kNumRegs = 8; // only 8 are needed
+  static constexpr IndexType kMaxNumRegs = 8; // only 8 are needed
 
   #elif USE_AVX2
   typedef __m256i vec_t;
@@ -48,7 +50,7 @@ namespace Eval::NNUE {
   #define vec_store(a,b) _mm256_store_si256(a,b)
   #define vec_add_16(a,b) _mm256_add_epi16(a,b)
   #define vec_sub_16(a,b) _mm256_sub_epi16(a,b)
-  static constexpr IndexType kNumRegs = 16;
+  static constexpr IndexType kMaxNumRegs = 16;
 
   #elif USE_SSE2
   typedef __m128i vec_t;
@@ -56,7 +58,7 @@ namespace Eval::NNUE {
   #define vec_store(a,b) *(a)=(b)
   #define vec_add_16(a,b) _mm_add_epi16(a,b)
   #define vec_sub_16(a,b) _mm_sub_epi16(a,b)
-  static constexpr IndexType kNumRegs = Is64Bit ? 16 : 8;
+  static constexpr IndexType kMaxNumRegs = Is64Bit ? 16 : 8;
 
   #elif USE_MMX
   typedef __m64 vec_t;
@@ -64,7 +66,7 @@ namespace Eval::NNUE {
   #define vec_store(a,b) *(a)=(b)
   #define vec_add_16(a,b) _mm_add_pi16(a,b)
   #define vec_sub_16(a,b) _mm_sub_pi16(a,b)
-  static constexpr IndexType kNumRegs = 8;
+  static constexpr IndexType kMaxNumRegs = 8;
 
   #elif USE_NEON
   typedef int16x8_t vec_t;
@@ -72,7 +74,7 @@ namespace Eval::NNUE {
   #define vec_store(a,b) *(a)=(b)
   #define vec_add_16(a,b) vaddq_s16(a,b)
   #define vec_sub_16(a,b) vsubq_s16(a,b)
-  static constexpr IndexType kNumRegs = 16;
+  static constexpr IndexType kMaxNumRegs = 16;
 
   #else
   #undef VECTOR
@@ -80,13 +82,18 @@ namespace Eval::NNUE {
   #endif
 
   // Input feature converter
+  template <IndexType TransformedFeatureDimensions>
   class FeatureTransformer {
 
    private:
     // Number of output dimensions for one side
-    static constexpr IndexType kHalfDimensions = kTransformedFeatureDimensions;
+    static constexpr IndexType kHalfDimensions = TransformedFeatureDimensions;
 
     #ifdef VECTOR
+    // Small transformers use fewer registers, so that a tile is not larger
+    // than the accumulator
+    static constexpr IndexType kNumRegs =
+        std::min<IndexType>(kMaxNumRegs, kHalfDimensions * 2 / sizeof(vec_t));
     static constexpr IndexType kTileHeight = kNumRegs * sizeof(vec_t) / 2;
     static_assert(kHalfDimensions % kTileHeight == 0, "kTileHeight must divide kHalfDimensions");
     #endif
@@ -120,10 +127,11 @@ namespace Eval::NNUE {
     }
 
     // Convert input features
-    void Transform(const Position& pos, OutputType* output) const {
+    void Transform(const Position& pos, OutputType* output,
+                   RefreshTable& refreshTable) const {
 
-      UpdateAccumulator(pos, WHITE);
-      UpdateAccumulator(pos, BLACK);
+      UpdateAccumulator(pos, WHITE, refreshTable);
+      UpdateAccumulator(pos, BLACK, refreshTable);
 
       const auto& accumulation = pos.state()->accumulator.accumulation;
 
@@ -167,7 +175,9 @@ namespace Eval::NNUE {
               &reinterpret_cast<const __m512i*>(accumulation[perspectives[p]][0])[j * 2 + 0]);
           __m512i sum1 = _mm512_load_si512(
               &reinterpret_cast<const __m512i*>(accumulation[perspectives[p]][0])[j * 2 + 1]);
-          _mm512_store_si512(&out[j], _mm512_permutexvar_epi64(kControl,
+          // Zero-masked, as the unmasked permutation has an undefined source
+          // which GCC reports as uninitialized
+          _mm512_store_si512(&out[j], _mm512_maskz_permutexvar_epi64(0xFF, kControl,
               _mm512_max_epi8(_mm512_packs_epi16(sum0, sum1), kZero)));
         }
 
@@ -236,7 +246,8 @@ namespace Eval::NNUE {
     }
 
    private:
-    void UpdateAccumulator(const Position& pos, const Color c) const {
+    void UpdateAccumulator(const Position& pos, const Color c,
+                           RefreshTable& refreshTable) const {
 
   #ifdef VECTOR
       // Gcc-10.2 unnecessarily spills AVX2 registers if this array
@@ -248,6 +259,7 @@ namespace Eval::NNUE {
       // of the estimated gain in terms of features to be added/subtracted.
       StateInfo *st = pos.state(), *next = nullptr;
       int gain = popcount(pos.pieces()) - 2;
+      int plies = 0;
       while (st->accumulator.state[c] == EMPTY)
       {
         auto& dp = st->dirtyPiece;
@@ -261,6 +273,7 @@ namespace Eval::NNUE {
           break;
         next = st;
         st = st->previous;
+        ++plies;
       }
 
       if (st->accumulator.state[c] == COMPUTED)
@@ -268,6 +281,9 @@ namespace Eval::NNUE {
         if (next == nullptr)
           return;
 
+        ++refreshTable.updates;
+        refreshTable.updatedPlies += plies;
+
         // Update incrementally in two steps. First, we update the "next"
         // accumulator. Then, we update the current accumulator (pos.state()).
 
@@ -356,21 +372,60 @@ namespace Eval::NNUE {
       }
       else
       {
-        // Refresh the accumulator
+        // Refresh the accumulator, starting from the cached accumulator of the
+        // last refresh with the same king square and applying only the pieces
+        // that differ. If the cached board is further away from the current one
+        // than the empty board, reset the cache entry to the biases first.
         auto& accumulator = pos.state()->accumulator;
         accumulator.state[c] = COMPUTED;
-        Features::IndexList active;
-        Features::HalfKP<Features::Side::kFriend>::AppendActiveIndices(pos, c, &active);
+        auto& entry = refreshTable.entries[pos.square<KING>(c)][c];
+
+        int distance = 0;
+        if (entry.computed)
+            for (Color color : { WHITE, BLACK })
+                for (PieceType pt = PAWN; pt < KING; ++pt)
+                    distance += popcount(  (entry.byColorBB[color] & entry.byTypeBB[pt])
+                                         ^ pos.pieces(color, pt));
+
+        if (!entry.computed || distance > popcount(pos.pieces()) - 2)
+        {
+          std::memcpy(entry.accumulation, biases_,
+              kHalfDimensions * sizeof(BiasType));
+          std::memset(entry.byColorBB, 0, sizeof(entry.byColorBB));
+          std::memset(entry.byTypeBB, 0, sizeof(entry.byTypeBB));
+          entry.computed = true;
+          ++refreshTable.refreshes;
+        }
+        else
+          ++refreshTable.cachedRefreshes;
+
+        Features::IndexList removed, added;
+        Features::HalfKP<Features::Side::kFriend>::AppendChangedIndices(pos,
+            entry.byColorBB, entry.byTypeBB, c, &removed, &added);
+
+        for (Color color : { WHITE, BLACK })
+            entry.byColorBB[color] = pos.pieces(color);
+        for (PieceType pt = PAWN; pt <= KING; ++pt)
+            entry.byTypeBB[pt] = pos.pieces(pt);
 
   #ifdef VECTOR
         for (IndexType j = 0; j < kHalfDimensions / kTileHeight; ++j)
         {
-          auto biasesTile = reinterpret_cast<const vec_t*>(
-              &biases_[j * kTileHeight]);
+          auto entryTile = reinterpret_cast<vec_t*>(
+              &entry.accumulation[j * kTileHeight]);
           for (IndexType k = 0; k < kNumRegs; ++k)
-            acc[k] = biasesTile[k];
+            acc[k] = vec_load(&entryTile[k]);
+
+          for (const auto index : removed)
+          {
+            const IndexType offset = kHalfDimensions * index + j * kTileHeight;
+            auto column = reinterpret_cast<const vec_t*>(&weights_[offset]);
 
-          for (const auto index : active)
+            for (unsigned k = 0; k < kNumRegs; ++k)
+              acc[k] = vec_sub_16(acc[k], column[k]);
+          }
+
+          for (const auto index : added)
           {
             const IndexType offset = kHalfDimensions * index + j * kTileHeight;
             auto column = reinterpret_cast<const vec_t*>(&weights_[offset]);
@@ -382,20 +437,31 @@ namespace Eval::NNUE {
           auto accTile = reinterpret_cast<vec_t*>(
               &accumulator.accumulation[c][0][j * kTileHeight]);
           for (unsigned k = 0; k < kNumRegs; k++)
+          {
+            vec_store(&entryTile[k], acc[k]);
             vec_store(&accTile[k], acc[k]);
+          }
         }
 
   #else
-        std::memcpy(accumulator.accumulation[c][0], biases_,
-            kHalfDimensions * sizeof(BiasType));
+        for (const auto index : removed)
+        {
+          const IndexType offset = kHalfDimensions * index;
+
+          for (IndexType j = 0; j < kHalfDimensions; ++j)
+            entry.accumulation[j] -= weights_[offset + j];
+        }
 
-        for (const auto index : active)
+        for (const auto index : added)
         {
           const IndexType offset = kHalfDimensions * index;
 
           for (IndexType j = 0; j < kHalfDimensions; ++j)
-            accumulator.accumulation[c][0][j] += weights_[offset + j];
+            entry.accumulation[j] += weights_[offset + j];
         }
+
+        std::memcpy(accumulator.accumulation[c][0], entry.accumulation,
+            kHalfDimensions * sizeof(BiasType));
   #endif
       }
 
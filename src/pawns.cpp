@@ -207,11 +207,16 @@ namespace Pawns {
 Entry* probe(const Position& pos) {
 
   Key key = pos.pawn_key();
-  Entry* e = pos.this_thread()->pawnsTable[key];
+  Table& table = pos.this_thread()->pawnsTable;
+  Entry* e = table[key];
 
   if (e->key == key)
+  {
+      ++table.hits;
       return e;
+  }
 
+  ++table.misses;
   e->key = key;
   e->blockedCount = 0;
   e->scores[WHITE] = evaluate<WHITE>(pos, e);
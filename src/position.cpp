@@ -17,7 +17,9 @@
 */
 
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <charconv>
 #include <cstddef> // For offsetof()
 #include <cstring> // For std::memset, std::memcmp
 #include <iomanip>
@@ -44,7 +46,29 @@ namespace Zobrist {
 
 namespace {
 
-const string PieceToChar(" PNBRQK  pnbrqk");
+constexpr std::string_view PieceToChar(" PNBRQK  pnbrqk");
+
+// What a character of the piece placement of a FEN stands for: the piece, if
+// any, and how far it moves the current square. The parsers look characters
+// up in a table instead of branching on them.
+struct FenChar {
+  Piece piece;
+  Direction advance;
+};
+
+constexpr auto FenChars = [] {
+  std::array<FenChar, 256> table{};
+
+  for (int pc = W_PAWN; pc <= B_KING; ++pc)
+      if (PieceToChar[pc] != ' ')
+          table[(unsigned char)PieceToChar[pc]] = { Piece(pc), EAST };
+
+  for (int n = 1; n <= 8; ++n)
+      table['0' + n] = { NO_PIECE, n * EAST };
+
+  table['/'] = { NO_PIECE, 2 * SOUTH };
+  return table;
+}();
 
 constexpr Piece Pieces[] = { W_PAWN, W_KNIGHT, W_BISHOP, W_ROOK, W_QUEEN, W_KING,
                              B_PAWN, B_KNIGHT, B_BISHOP, B_ROOK, B_QUEEN, B_KING };
@@ -932,9 +956,10 @@ void Position::init() {
 
 /// Position::set() initializes the position object with the given FEN string.
 /// This function is not very robust - make sure that input FENs are correct,
-/// this is assumed to be the responsibility of the GUI.
+/// this is assumed to be the responsibility of the GUI, or use is_valid_fen().
+/// The FEN is read in place, without any allocation.
 
-Position& Position::set(const string& fenStr, bool isChess960, StateInfo* si, Thread* th) {
+Position& Position::set(std::string_view fenStr, bool isChess960, StateInfo* si, Thread* th) {
 /*
    A FEN string defines a particular position using only the ASCII character set.
 
@@ -970,43 +995,48 @@ Position& Position::set(const string& fenStr, bool isChess960, StateInfo* si, Th
       incremented after Black's move.
 */
 
-  unsigned char col, row, token;
-  size_t idx;
+  unsigned char col, row, token = ' ';
+  size_t cur = 0;
   Square sq = SQ_A8;
-  std::istringstream ss(fenStr);
 
   std::memset(this, 0, sizeof(Position));
   std::memset(si, 0, sizeof(StateInfo));
   st = si;
 
-  ss >> std::noskipws;
+  // Read the next character, if any
+  auto next = [&](unsigned char& c) {
+      return cur < fenStr.size() ? (c = fenStr[cur++], true) : false;
+  };
+
+  // Read a number after blanks, if any
+  auto number = [&](int& n) {
+      while (cur < fenStr.size() && isspace((unsigned char)fenStr[cur]))
+          ++cur;
+      cur = std::from_chars(fenStr.data() + cur, fenStr.data() + fenStr.size(), n).ptr - fenStr.data();
+  };
 
   // 1. Piece placement
-  while ((ss >> token) && !isspace(token))
+  while (next(token) && !isspace(token))
   {
-      if (isdigit(token))
-          sq += (token - '0') * EAST; // Advance the given number of files
-
-      else if (token == '/')
-          sq += 2 * SOUTH;
+      // Put the piece, if any, then advance the given number of files or go
+      // down to the next rank. Other characters are ignored.
+      if (FenChars[token].piece != NO_PIECE)
+          put_piece(FenChars[token].piece, sq);
 
-      else if ((idx = PieceToChar.find(token)) != string::npos) {
-          put_piece(Piece(idx), sq);
-          ++sq;
-      }
+      sq += FenChars[token].advance;
   }
 
   // 2. Active color
-  ss >> token;
+  next(token);
   sideToMove = (token == 'w' ? WHITE : BLACK);
-  ss >> token;
+  next(token);
 
   // 3. Castling availability. Compatible with 3 standards: Normal FEN standard,
   // Shredder-FEN that uses the letters of the columns on which the rooks began
   // the game instead of KQkq and also X-FEN standard that, in case of Chess960,
   // if an inner rook is associated with the castling right, the castling tag is
   // replaced by the file letter of the involved rook, as for the Shredder-FEN.
-  while ((ss >> token) && !isspace(token))
+  while (next(token) && !isspace(token))
   {
       Square rsq;
       Color c = islower(token) ? BLACK : WHITE;
@@ -1033,8 +1063,8 @@ Position& Position::set(const string& fenStr, bool isChess960, StateInfo* si, Th
   // Ignore if square is invalid or not on side to move relative rank 6.
   bool enpassant = false;
 
-  if (   ((ss >> col) && (col >= 'a' && col <= 'h'))
-      && ((ss >> row) && (row == (sideToMove == WHITE ? '6' : '3'))))
+  if (   (next(col) && (col >= 'a' && col <= 'h'))
+      && (next(row) && (row == (sideToMove == WHITE ? '6' : '3'))))
   {
       st->epSquare = make_square(File(col - 'a'), Rank(row - '1'));
 
@@ -1052,7 +1082,8 @@ Position& Position::set(const string& fenStr, bool isChess960, StateInfo* si, Th
 
   // It's necessary for st->previous to be intialized in this way because legality check relies on its existence
   if (enpassant) {
-      st->previous = new StateInfo();
+      std::memset(&epPrevious, 0, sizeof(StateInfo));
+      st->previous = &epPrevious;
       remove_piece(st->epSquare - pawn_push(sideToMove));
       st->previous->checkersBB = attackers_to(square<KING>(~sideToMove)) & pieces(sideToMove);
       st->previous->blockersForKing[WHITE] = slider_blockers(pieces(BLACK), square<KING>(WHITE), st->previous->pinners[BLACK]);
@@ -1063,7 +1094,8 @@ Position& Position::set(const string& fenStr, bool isChess960, StateInfo* si, Th
       st->epSquare = SQ_NONE;
 
   // 5-6. Halfmove clock and fullmove number
-  ss >> std::skipws >> st->rule50 >> gamePly;
+  number(st->rule50);
+  number(gamePly);
 
   // Convert from fullmove starting from 1 to gamePly starting from 0,
   // handle also common incorrect FEN with fullmove = 0.
@@ -1161,6 +1193,110 @@ void Position::set_state(StateInfo* si) const {
 }
 
 
+/// Position::is_valid_fen() tells whether a FEN string is well-formed: a board
+/// of eight ranks of eight squares, one king of each color, no pawn on the
+/// first and last ranks, castling rooks where the castling rights need them,
+/// an en passant square on the right rank and numeric move counters, if any.
+/// It does not set up the position, which makes it cheap enough to filter the
+/// input of bulk tools before calling set(). Checks of the side not to move
+/// are not detected.
+
+bool Position::is_valid_fen(std::string_view fen) {
+
+  Bitboard rooks[COLOR_NB] = {};
+  int kings[COLOR_NB] = {};
+  size_t cur = 0;
+
+  fen = fen.substr(0, fen.find_last_not_of(' ') + 1); // Trailing blanks
+
+  // Read the next field, which must follow a single space unless it is the first
+  auto field = [&]() {
+      if (cur && (cur >= fen.size() || fen[cur++] != ' '))
+          return std::string_view();
+      size_t start = cur;
+      while (cur < fen.size() && fen[cur] != ' ')
+          ++cur;
+      return fen.substr(start, cur - start);
+  };
+
+  // 1. Piece placement
+  int rank = RANK_8, file = FILE_A;
+
+  for (unsigned char c : field())
+  {
+      Piece pc = FenChars[c].piece;
+
+      if (c == '/')
+      {
+          if (file != FILE_NB || rank == RANK_1)
+              return false;
+          --rank, file = FILE_A;
+          continue;
+      }
+
+      if (pc != NO_PIECE)
+      {
+          if (type_of(pc) == PAWN && (rank == RANK_1 || rank == RANK_8))
+              return false;
+
+          kings[color_of(pc)] += type_of(pc) == KING;
+
+          if (type_of(pc) == ROOK && file < FILE_NB)
+              rooks[color_of(pc)] |= make_square(File(file), Rank(rank));
+      }
+
+      // Characters which are neither pieces nor digits do not advance
+      if (!FenChars[c].advance || (file += FenChars[c].advance) > FILE_NB)
+          return false;
+  }
+
+  if (rank != RANK_1 || file != FILE_NB || kings[WHITE] != 1 || kings[BLACK] != 1)
+      return false;
+
+  // 2. Active color
+  std::string_view side = field();
+  if (side != "w" && side != "b")
+      return false;
+
+  // 3. Castling availability, with a rook of the color on its first rank
+  std::string_view castling = field();
+  if (castling.empty() || castling.size() > 4 || (castling[0] == '-' && castling.size() > 1))
+      return false;
+
+  for (char c : castling)
+  {
+      if (c == '-')
+          continue;
+
+      Color color = islower(c) ? BLACK : WHITE;
+      Bitboard firstRank = rooks[color] & rank_bb(relative_rank(color, RANK_1));
+      char upper = char(toupper(c));
+
+      if (  upper == 'K' || upper == 'Q' ? !firstRank
+          : upper >= 'A' && upper <= 'H' ? !(firstRank & file_bb(File(upper - 'A')))
+          : true)
+          return false;
+  }
+
+  // 4. En passant square
+  std::string_view ep = field();
+  if (   ep != "-"
+      && (   ep.size() != 2 || ep[0] < 'a' || ep[0] > 'h'
+          || ep[1] != (side == "w" ? '6' : '3')))
+      return false;
+
+  // 5-6. Halfmove clock and fullmove number, which may be missing
+  for (int i = 0; i < 2 && cur < fen.size(); ++i)
+  {
+      std::string_view counter = field();
+      if (counter.empty() || !std::all_of(counter.begin(), counter.end(), isdigit))
+          return false;
+  }
+
+  return cur == fen.size();
+}
+
+
 /// Position::set() is an overload to initialize the position object with
 /// the given endgame code string like "KBPKN". It is mainly a helper to
 /// get the material key out of an endgame code.
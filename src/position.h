@@ -23,6 +23,7 @@
 #include <deque>
 #include <memory> // For std::unique_ptr
 #include <string>
+#include <string_view>
 
 #include "bitboard.h"
 #include "evaluate.h"
@@ -85,7 +86,8 @@ public:
   Position& operator=(const Position&) = delete;
 
   // FEN string input/output
-  Position& set(const std::string& fenStr, bool isChess960, StateInfo* si, Thread* th);
+  Position& set(std::string_view fenStr, bool isChess960, StateInfo* si, Thread* th);
+  static bool is_valid_fen(std::string_view fen);
   Position& set(const std::string& code, Color c, StateInfo* si);
   const std::string fen() const;
 
@@ -201,6 +203,7 @@ private:
   Thread* thisThread;
   StateInfo* st;
   bool chess960;
+  StateInfo epPrevious; // Stands for the position before the double push of an en passant FEN
 };
 
 extern std::ostream& operator<<(std::ostream& os, const Position& pos);
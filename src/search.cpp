@@ -17,9 +17,11 @@
 */
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
 #include <cstring>   // For std::memset
+#include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <random> 
@@ -38,6 +40,7 @@
 #include "syzygy/tbprobe.h"
 
 #include "experience.h"
+#include "idea.h"
 
 namespace Search {
 
@@ -90,6 +93,12 @@ namespace {
 
   int tactical;
 
+  // The search stops on Threads.stop, and in EPD analysis also when the thread
+  // reaches the limit of its own position.
+  bool stopped(const Thread* th) {
+    return Threads.stop.load(std::memory_order_relaxed) || th->limitReached;
+  }
+
   // Breadcrumbs are used to mark nodes as being searched by a given thread
   struct Breadcrumb {
     std::atomic<Thread*> thread;
@@ -133,6 +142,24 @@ namespace {
     bool otherThread, owning;
   };
 
+  // ABDADA mode: moves leading to a node where another thread has left its
+  // breadcrumb are deferred until the other moves have been searched
+  bool abdada;
+
+  // Returns true if another thread is in the moves loop of the given node
+  bool searched_by_other(Thread* thisThread, Key posKey, int ply) {
+
+    if (ply >= 8)
+        return false;
+
+    Breadcrumb& b = breadcrumbs[posKey & (breadcrumbs.size() - 1)];
+    Thread* tmp = b.thread.load(std::memory_order_relaxed);
+
+    return    tmp != nullptr
+           && tmp != thisThread
+           && b.key.load(std::memory_order_relaxed) == posKey;
+  }
+
   int openingVariety;
   
   template <NodeType NT>
@@ -149,32 +176,130 @@ namespace {
   void update_all_stats(const Position& pos, Stack* ss, Move bestMove, Value bestValue, Value beta, Square prevSq,
                         Move* quietsSearched, int quietCount, Move* capturesSearched, int captureCount, Depth depth);
 
+  // The perft hash keeps the leaf count of a subtree with its position key and
+  // depth. The threads write to it without locks: an entry stores its key XORed
+  // with its data, so that an entry torn by two concurrent writes is a miss.
+  struct PerftEntry {
+    std::atomic<uint64_t> key, data;
+  };
+
+  std::unique_ptr<PerftEntry[]> perftTable;
+  size_t perftEntries;
+
+  // The root moves of "go perft", shared by the threads, and their leaf counts
+  std::vector<Move> perftMoves;
+  std::vector<uint64_t> perftCounts;
+  std::atomic<size_t> perftNext;
+
   // perft() is our utility to verify move generation. All the leaf nodes up
   // to the given depth are generated and counted, and the sum is returned.
-  template<bool Root>
   uint64_t perft(Position& pos, Depth depth) {
 
+    PerftEntry* tte = depth > 2 && perftEntries ? &perftTable[mul_hi64(pos.key(), perftEntries)] : nullptr;
+
+    if (tte)
+    {
+        uint64_t data = tte->data.load(std::memory_order_relaxed);
+        if (   (tte->key.load(std::memory_order_relaxed) ^ data) == pos.key()
+            && Depth(data & 0xFF) == depth)
+            return data >> 8;
+    }
+
     StateInfo st;
     ASSERT_ALIGNED(&st, Eval::NNUE::kCacheLineSize);
 
-    uint64_t cnt, nodes = 0;
+    uint64_t nodes = 0;
     const bool leaf = (depth == 2);
 
     for (const auto& m : MoveList<LEGAL>(pos))
     {
-        if (Root && depth <= 1)
-            cnt = 1, nodes++;
-        else
+        assert(pos.pseudo_legal(m) && pos.legal(m));
+
+        pos.do_move(m, st);
+        nodes += leaf ? MoveList<LEGAL>(pos).size() : perft(pos, depth - 1);
+        pos.undo_move(m);
+    }
+
+    if (tte)
+    {
+        uint64_t data = nodes << 8 | uint64_t(depth);
+        tte->key.store(pos.key() ^ data, std::memory_order_relaxed);
+        tte->data.store(data, std::memory_order_relaxed);
+    }
+
+    return nodes;
+  }
+
+
+  // perft_split() is run by all the threads for "go perft". They take the root
+  // moves one at a time and count the leaf nodes under each of them.
+  void perft_split(Thread* th) {
+
+    Position& pos = th->rootPos;
+    StateInfo st;
+    ASSERT_ALIGNED(&st, Eval::NNUE::kCacheLineSize);
+
+    for (size_t i; (i = perftNext++) < perftMoves.size(); )
+    {
+        if (Limits.perft <= 1)
         {
-            pos.do_move(m, st);
-            cnt = leaf ? MoveList<LEGAL>(pos).size() : perft<false>(pos, depth - 1);
-            nodes += cnt;
-            pos.undo_move(m);
+            perftCounts[i] = 1;
+            continue;
         }
-        if (Root)
-            sync_cout << UCI::move(m, pos.is_chess960()) << ": " << cnt << sync_endl;
+
+        pos.do_move(perftMoves[i], st);
+        perftCounts[i] = Limits.perft == 2 ? MoveList<LEGAL>(pos).size() : perft(pos, Limits.perft - 1);
+        pos.undo_move(perftMoves[i]);
     }
-    return nodes;
+  }
+
+  // Parallel MultiPV: the last iteration completed by all the threads that
+  // search a share of the root moves and have completed one, or 0 if none has.
+  Depth common_depth() {
+
+    Depth depth = MAX_PLY;
+
+    for (Thread* th : Threads)
+    {
+        std::lock_guard<std::mutex> lock(th->linesMutex);
+        if (th->shareLines && !th->completedLines.empty())
+            depth = std::min(depth, Depth(th->completedLines.size() - 1));
+    }
+
+    return depth == MAX_PLY ? 0 : depth;
+  }
+
+  // Parallel MultiPV: the lines of all the threads, best first. Each thread
+  // gives its lines of iteration 'depth', or of its last completed iteration
+  // if it has not got there yet, so that only the lines of the same depth are
+  // compared when 'depth' is the common_depth(). The depth of each line is
+  // appended to 'depths' if given.
+  RootMoves merged_lines(Depth depth, std::vector<Depth>* depths = nullptr) {
+
+    std::vector<std::pair<RootMove, Depth>> all;
+
+    for (Thread* th : Threads)
+    {
+        std::lock_guard<std::mutex> lock(th->linesMutex);
+        if (th->completedLines.empty())
+            continue;
+
+        Depth d = std::min(depth, Depth(th->completedLines.size() - 1));
+        for (const RootMove& rm : th->completedLines[d])
+            all.emplace_back(rm, d);
+    }
+
+    std::stable_sort(all.begin(), all.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    RootMoves lines;
+    for (const auto& [rm, d] : all)
+    {
+        lines.push_back(rm);
+        if (depths)
+            depths->push_back(d);
+    }
+
+    return lines;
   }
 
 } // namespace
@@ -215,7 +340,39 @@ void MainThread::search() {
 
   if (Limits.perft)
   {
-      nodes = perft<true>(rootPos, Limits.perft);
+      // The root moves are shared by all the threads. The perft hash is as
+      // large as the transposition table, which is left untouched, and perft
+      // runs without it if it cannot be allocated.
+      perftEntries = size_t(Options["Hash"]) * 1024 * 1024 / sizeof(PerftEntry);
+      perftTable.reset(new (std::nothrow) PerftEntry[perftEntries]());
+      if (!perftTable)
+          perftEntries = 0;
+
+      perftMoves.clear();
+      for (const auto& m : MoveList<LEGAL>(rootPos))
+          perftMoves.push_back(m);
+
+      perftCounts.assign(perftMoves.size(), 0);
+      perftNext = 0;
+
+      Threads.start_searching(); // start non-main threads
+      perft_split(this);
+      Threads.wait_for_search_finished();
+
+      perftTable.reset();
+      perftEntries = 0;
+
+      // The sum of the counts is reported as the nodes of the main thread, so
+      // that bench gives the perft speed.
+      nodes = 0;
+      for (size_t i = 0; i < perftMoves.size(); ++i)
+      {
+          if (Limits.divide)
+              sync_cout << UCI::move(perftMoves[i], rootPos.is_chess960()) << ": " << perftCounts[i] << sync_endl;
+
+          nodes += perftCounts[i];
+      }
+
       sync_cout << "\nNodes searched: " << nodes << "\n" << sync_endl;
       return;
   }
@@ -233,6 +390,12 @@ void MainThread::search() {
   Eval::NNUE::verify();
   openingVariety = Options["Variety"];
   tactical = Options["multiPV Search"];
+  abdada = Options["ABDADA"];
+
+  Threads.parallelMultiPV =   Options["Parallel MultiPV"]
+                           && Threads.size() > 1
+                           && (int(Options["MultiPV"]) > 1 || tactical)
+                           && rootMoves.size() > 1;
 
   Move bookMove = MOVE_NONE;
 
@@ -437,6 +600,18 @@ void MainThread::search() {
   while (!Threads.stop && (ponder || Limits.infinite))
   {} // Busy wait for a stop or a ponder reset
 
+  // In parallel MultiPV mode the helper threads search their own root moves
+  // up to the depth limit, so let them finish their last iteration. The time
+  // and nodes limits are still checked meanwhile, as during the search.
+  if (Threads.parallelMultiPV && Limits.depth)
+      for (Thread* th : Threads)
+          while (th != this && !Threads.stop && th->is_searching())
+          {
+              callsCnt = 0;
+              check_time();
+              std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          }
+
   // Stop the threads if not already stopped (also raise the stop if
   // "ponderhit" just reset Threads.ponder).
   Threads.stop = true;
@@ -444,6 +619,10 @@ void MainThread::search() {
   // Wait until all threads have finished
   Threads.wait_for_search_finished();
 
+#if defined(USE_STATS)
+  sync_cout << "info string stats " << Threads.stats().search_info() << sync_endl;
+#endif
+
   // When playing in 'nodes as time' mode, subtract the searched nodes from
   // the available ones before exiting.
   if (Limits.npmsec)
@@ -451,9 +630,33 @@ void MainThread::search() {
 
   Thread* bestThread = this;
 
-  if (    int(Options["MultiPV"]) == 1
-      && !Limits.depth
-      &&  rootMoves[0].pv[0] != MOVE_NONE)
+  // In parallel MultiPV mode the best move is the best of the lines of all
+  // the threads at the last iteration they have all completed. The line is
+  // brought to the front of the root moves of the thread that searched it,
+  // to be reported and recorded at that depth.
+  if (Threads.parallelMultiPV)
+  {
+      Depth depth = common_depth();
+      RootMoves lines = merged_lines(depth);
+
+      for (Thread* th : Threads)
+      {
+          auto it = lines.empty() ? th->rootMoves.end()
+                  : std::find(th->rootMoves.begin(), th->rootMoves.end(), lines[0].pv[0]);
+
+          if (th->shareLines && it != th->rootMoves.end())
+          {
+              *it = lines[0];
+              std::rotate(th->rootMoves.begin(), it, it + 1);
+              th->completedDepth = depth;
+              bestThread = th;
+              break;
+          }
+      }
+  }
+  else if (    int(Options["MultiPV"]) == 1
+           && !Limits.depth
+           &&  rootMoves[0].pv[0] != MOVE_NONE)
       bestThread = Threads.get_best_thread();
 
   if (    bookMove == MOVE_NONE
@@ -521,8 +724,9 @@ void MainThread::search() {
 
   bestPreviousScore = bestThread->rootMoves[0].score;
 
-  // Send again PV info if we have a new best thread
-  if (bestThread != this)
+  // Send again PV info if we have a new best thread, or the lines merged from
+  // all the threads in parallel MultiPV mode
+  if (bestThread != this || Threads.parallelMultiPV)
       sync_cout << UCI::pv(bestThread->rootPos, bestThread->completedDepth, -VALUE_INFINITE, VALUE_INFINITE) << sync_endl;
 
   sync_cout << "bestmove " << UCI::move(bestThread->rootMoves[0].pv[0], rootPos.is_chess960());
@@ -540,6 +744,12 @@ void MainThread::search() {
 
 void Thread::search() {
 
+  if (Limits.perft)
+  {
+      perft_split(this);
+      return;
+  }
+
   // To allow access to (ss-7) up to (ss+2), the stack must be oversized.
   // The former is needed to allow update_continuation_histories(ss-1, ...),
   // which accesses its argument at ss-6, also near the root.
@@ -549,7 +759,7 @@ void Thread::search() {
   Value bestValue, alpha, beta, delta;
   Move  lastBestMove = MOVE_NONE;
   Depth lastBestMoveDepth = 0;
-  MainThread* mainThread = (this == Threads.main() ? Threads.main() : nullptr);
+  MainThread* mainThread = (this == Threads.main() && !Threads.analysing ? Threads.main() : nullptr);
   double timeReduction = 1, totBestMoveChanges = 0;
   Color us = rootPos.side_to_move();
   int iterIdx = 0;
@@ -576,8 +786,54 @@ void Thread::search() {
   std::copy(&lowPlyHistory[2][0], &lowPlyHistory.back().back() + 1, &lowPlyHistory[0][0]);
   std::fill(&lowPlyHistory[MAX_LPH - 2][0], &lowPlyHistory.back().back() + 1, 0);
 
+  // Keep only the root moves dealt to share 'n' of 'shares'
+  auto keep_share = [&](size_t n, size_t shares) {
+      Search::RootMoves share;
+      for (size_t i = n; i < rootMoves.size(); i += shares)
+          share.push_back(rootMoves[i]);
+      rootMoves = share;
+  };
+
+  // In parallel MultiPV mode the root moves are dealt out to the threads, each
+  // of them searching the lines of its own moves. The threads that get no move
+  // search all of them as in Lazy SMP, but do not report their lines.
+  size_t rootMoveCount = rootMoves.size();
+  size_t sharers = std::min(Threads.size(), rootMoveCount);
+  partialRoot = false;
+
+  {
+      std::lock_guard<std::mutex> lock(linesMutex);
+      shareLines = Threads.parallelMultiPV && idx < sharers;
+  }
+
+  if (shareLines)
+      keep_share(idx, sharers);
+
+  // The brute force threads other than the main thread deal out the root moves
+  // among themselves, so that each one proves its own moves without pruning.
+  // Their results reach the other threads through the TT.
+  else if (fullSearch && !mainThread && !Threads.parallelMultiPV && !Threads.analysing)
+  {
+      size_t n = 0, bruteForcers = 0;
+      for (Thread* th : Threads)
+          if (th->fullSearch && th != Threads.main())
+          {
+              if (th == this)
+                  n = bruteForcers;
+              ++bruteForcers;
+          }
+
+      bruteForcers = std::min(bruteForcers, rootMoves.size());
+      if (n < bruteForcers && bruteForcers > 1)
+      {
+          keep_share(n, bruteForcers);
+          partialRoot = true;
+      }
+  }
+
   size_t multiPV = size_t(Options["MultiPV"]);
   if (tactical) multiPV = size_t(pow(2, tactical));
+  if (Threads.analysing && Threads.analysisPV) multiPV = Threads.analysisPV;
   multiPV = std::min(multiPV, rootMoves.size());
   ttHitAverage = ttHitAverageWindow * ttHitAverageResolution / 2;
 
@@ -599,8 +855,8 @@ void Thread::search() {
 
   // Iterative deepening loop until requested to stop or the target depth is reached
   while (   ++rootDepth < MAX_PLY
-         && !Threads.stop
-         && !(Limits.depth && mainThread && rootDepth > Limits.depth))
+         && !stopped(this)
+         && !(Limits.depth && (mainThread || Threads.parallelMultiPV || Threads.analysing) && rootDepth > Limits.depth))
   {
       // Age out PV variability metric
       if (mainThread)
@@ -618,7 +874,7 @@ void Thread::search() {
          searchAgainCounter++;
 
       // MultiPV loop. We perform a full root search for each PV line
-      for (pvIdx = 0; pvIdx < multiPV && !Threads.stop; ++pvIdx)
+      for (pvIdx = 0; pvIdx < multiPV && !stopped(this); ++pvIdx)
       {
           if (pvIdx == pvLast)
           {
@@ -665,7 +921,7 @@ void Thread::search() {
               // If search has been stopped, we break immediately. Sorting is
               // safe because RootMoves is still valid, although it refers to
               // the previous iteration.
-              if (Threads.stop)
+              if (stopped(this))
                   break;
 
               // When failing high/low give some update (without cluttering
@@ -701,15 +957,43 @@ void Thread::search() {
           std::stable_sort(rootMoves.begin() + pvFirst, rootMoves.begin() + pvIdx + 1);
 
           if (    mainThread
+              && !Threads.parallelMultiPV
               && (Threads.stop || pvIdx + 1 == multiPV || Time.elapsed() > 3000))
               sync_cout << UCI::pv(rootPos, rootDepth, alpha, beta) << sync_endl;
       }
 
-      if (!Threads.stop)
+      if (!stopped(this))
+      {
           completedDepth = rootDepth;
 
-      if (rootMoves[0].pv[0] != lastBestMove) {
-         lastBestMove = rootMoves[0].pv[0];
+          if (shareLines)
+          {
+              std::lock_guard<std::mutex> lock(linesMutex);
+              completedLines.resize(completedDepth + 1);
+              completedLines[completedDepth].assign(rootMoves.begin(), rootMoves.begin() + multiPV);
+          }
+
+          if (mainThread && Threads.parallelMultiPV)
+              sync_cout << UCI::pv(rootPos, rootDepth, alpha, beta) << sync_endl;
+      }
+
+      Move iterBestMove = rootMoves[0].pv[0];
+
+      // In parallel MultiPV mode the main thread manages the time with the best
+      // of the lines of all the threads, at the last iteration they have all
+      // completed, instead of the best line of its own share.
+      if (mainThread && Threads.parallelMultiPV)
+      {
+          RootMoves lines = merged_lines(common_depth());
+          if (!lines.empty())
+          {
+              iterBestMove = lines[0].pv[0];
+              bestValue = lines[0].score;
+          }
+      }
+
+      if (iterBestMove != lastBestMove) {
+         lastBestMove = iterBestMove;
          lastBestMoveDepth = rootDepth;
       }
 
@@ -747,7 +1031,7 @@ void Thread::search() {
           TimePoint optimumT = Time.optimum();
 
           // Stop the search if we have only one legal move, or if available time elapsed
-          if (   (rootMoves.size() == 1 && (elapsedT > optimumT / 16))
+          if (   (rootMoveCount == 1 && (elapsedT > optimumT / 16))
               || elapsedT > optimumT * fallingEval * reduction * bestMoveInstability)
           {
               // If we are allowed to ponder do not stop the search now but
@@ -776,6 +1060,144 @@ void Thread::search() {
 }
 
 
+/// MainThread::analyse() is started by the "analyse" command. The main thread
+/// searches EPD positions like the other threads, and returns when all of the
+/// positions have been searched.
+
+void MainThread::analyse() {
+
+  Experience::wait_for_loading_finished();
+
+  TT.new_search();
+  Eval::NNUE::verify();
+  openingVariety = Options["Variety"];
+  tactical = Options["multiPV Search"];
+  abdada = Options["ABDADA"];
+
+  // The root probe results of Tablebases::rank_root_moves() are shared by all
+  // the threads, so the tablebases are only probed below the root here.
+  TB::RootInTB = false;
+  TB::UseRule50 = bool(Options["Syzygy50MoveRule"]);
+  TB::ProbeDepth = int(Options["SyzygyProbeDepth"]);
+  TB::Cardinality = int(Options["SyzygyProbeLimit"]);
+
+  if (TB::Cardinality > TB::MaxCardinality)
+  {
+      TB::Cardinality = TB::MaxCardinality;
+      TB::ProbeDepth = 0;
+  }
+
+  Threads.start_searching(); // start non-main threads
+  Thread::analyse();         // main thread start analysing
+
+  Threads.wait_for_search_finished();
+  Threads.analysing = false;
+}
+
+
+/// Thread::search_position() searches rootPos on its own, with the limits of
+/// the analysis. Returns false if there is no legal move to search.
+
+bool Thread::search_position() {
+
+  rootMoves.clear();
+
+  for (const auto& m : MoveList<LEGAL>(rootPos))
+      rootMoves.emplace_back(m);
+
+  if (rootMoves.empty())
+      return false;
+
+  rootDepth = completedDepth = 0;
+  nmpGuard = bestMoveChanges = 0;
+  callsCnt = 0;
+  limitReached = false;
+  analysisStart = now();
+  analysisNodes = nodes;
+
+  Thread::search();
+
+  return true;
+}
+
+
+/// Thread::analyse() takes the EPD positions one at a time from the pool and
+/// searches them from its own root position until there are no positions left.
+/// The result of each search is written as an EPD line with the best move,
+/// evaluation, depth, nodes and PV, and the id of the input line if any.
+
+void Thread::analyse() {
+
+  // The threads of the "idea" command expand the leaves of its tree instead
+  if (Idea::building())
+  {
+      Idea::work(this);
+      return;
+  }
+
+  size_t i;
+
+  while (!Threads.stop && (i = Threads.nextEpd++) < Threads.epds.size())
+  {
+      const string& epd = Threads.epds[i];
+      std::istringstream is(epd);
+      string token, fen, id;
+
+      // The first four fields are the position, the operations follow
+      for (int field = 0; field < 4 && is >> token; ++field)
+          fen += token + " ";
+
+      size_t idPos = epd.find(" id ");
+      if (idPos != string::npos)
+          id = " " + epd.substr(idPos + 1, epd.find(';', idPos) - idPos - 1) + ";";
+
+      // set() does not check its input, so report the malformed lines
+      if (!Position::is_valid_fen(fen))
+      {
+          sync_cout << "info string Invalid EPD: " << epd << sync_endl;
+          continue;
+      }
+
+      rootPos.set(fen, Options["UCI_Chess960"], &rootState, this);
+
+      if (!search_position())
+      {
+          sync_cout << fen << "ce " << (rootPos.checkers() ? -32767 : 0) << "; acd 0;" << id << sync_endl;
+          continue;
+      }
+
+      RootMove& rm = rootMoves[0];
+      Value v = rm.score != -VALUE_INFINITE ? rm.score : rm.previousScore;
+
+      std::stringstream ss;
+      ss << fen << "bm " << UCI::san(rootPos, rm.pv[0]) << ";";
+
+      // Mates are given as 32767 minus the number of moves to mate
+      if (v != -VALUE_INFINITE)
+          ss << " ce " << (  abs(v) < VALUE_MATE_IN_MAX_PLY ? v * 100 / PawnValueEg
+                           : v > 0 ? 32767 - (VALUE_MATE - v + 1) / 2
+                                   : (VALUE_MATE + v) / 2 - 32767) << ";";
+
+      ss << " acd " << completedDepth << "; acn " << nodes - analysisNodes << "; pv";
+
+      std::vector<StateInfo> states(rm.pv.size());
+
+      for (size_t j = 0; j < rm.pv.size(); ++j)
+      {
+          ss << " " << UCI::san(rootPos, rm.pv[j]);
+          rootPos.do_move(rm.pv[j], states[j]);
+      }
+
+      for (size_t j = rm.pv.size(); j > 0; --j)
+          rootPos.undo_move(rm.pv[j - 1]);
+
+      ss << ";" << id;
+
+      sync_cout << ss.str() << sync_endl;
+  }
+}
+
+
 namespace {
 
   // search<>() is the main search function for both PV and non-PV nodes
@@ -826,7 +1248,9 @@ namespace {
       improving = true;
   
     // Check for the available remaining time
-    if (thisThread == Threads.main())
+    if (Threads.analysing)
+        thisThread->check_limits();
+    else if (thisThread == Threads.main())
         static_cast<MainThread*>(thisThread)->check_time();
 
     thisThread->nodes++;
@@ -841,6 +1265,9 @@ namespace {
     excludedMove = ss->excludedMove;
     posKey = excludedMove == MOVE_NONE ? pos.key() : pos.key() ^ make_key(excludedMove);
     tte = TT.probe(posKey, ss->ttHit);
+    STATS_INC(thisThread, TT_PROBES);
+    if (ss->ttHit)
+        STATS_INC(thisThread, TT_HITS);
     ttValue = ss->ttHit ? value_from_tt(tte->value(), ss->ply, pos.rule50_count()) : VALUE_NONE;
     ttDepth = tte->depth();
     ttBound = tte->bound();
@@ -883,7 +1310,7 @@ namespace {
         if (pos.is_draw(ss->ply))
             return VALUE_DRAW;
 
-        if (Threads.stop.load(std::memory_order_relaxed) || ss->ply >= MAX_PLY)
+        if (stopped(thisThread) || ss->ply >= MAX_PLY)
             return ss->ply >= MAX_PLY && !ss->inCheck ? evaluate(pos)
                                                       : VALUE_DRAW;
 
@@ -916,6 +1343,10 @@ namespace {
 
     //Probe experience data
     const Experience::ExpEntryEx *expEx = excludedMove == MOVE_NONE && Experience::enabled() ? Experience::probe(pos.key()) : nullptr;
+    if (excludedMove == MOVE_NONE && Experience::enabled())
+        STATS_INC(thisThread, EXP_PROBES);
+    if (expEx)
+        STATS_INC(thisThread, EXP_HITS);
     const Experience::ExpEntryEx* tempExp = expEx;
     const Experience::ExpEntryEx* bestExp = nullptr;
 
@@ -1150,6 +1581,7 @@ namespace {
            ss->continuationHistory = &thisThread->continuationHistory[0][0][NO_PIECE][0];
 
            pos.do_null_move(st);
+           STATS_INC(thisThread, NULL_MOVES);
 
            Value nullValue = -search<NonPV>(pos, ss+1, -beta, -beta+1, depth-R, !cutNode);
 
@@ -1157,6 +1589,8 @@ namespace {
 
            if (nullValue >= beta)
            {
+               STATS_INC(thisThread, NULL_CUTOFFS);
+
                // Do not return unproven mate or TB scores
                nullValue = std::min(nullValue, VALUE_TB_WIN_IN_MAX_PLY);
 
@@ -1284,9 +1718,14 @@ namespace {
     // Mark this node as being searched
     ThreadHolding th(thisThread, posKey, ss->ply);
 
+    Move deferredMoves[32];
+    int deferredMoveCounts[32];
+    int deferredCount = 0, deferredIdx = 0;
+
     // Step 12. Loop through all pseudo-legal moves until no moves remain
-    // or a beta cutoff occurs.
-    while ((move = mp.next_move(moveCountPruning)) != MOVE_NONE)
+    // or a beta cutoff occurs. Then search the deferred moves, if any.
+    while (   (move = mp.next_move(moveCountPruning)) != MOVE_NONE
+           || (deferredIdx < deferredCount && (move = deferredMoves[deferredIdx++]) != MOVE_NONE))
     {
       assert(is_ok(move));
 
@@ -1301,9 +1740,28 @@ namespace {
                                   thisThread->rootMoves.begin() + thisThread->pvLast, move))
           continue;
 
-      ss->moveCount = ++moveCount;
+      // In ABDADA mode, once the first move has been searched, postpone the
+      // moves whose subtree is being searched by another thread. When we come
+      // back to them the other thread has likely stored its result in the TT.
+      // A deferred move keeps the move count it has in the order of the move
+      // picker, so that deferring it changes neither the pruning and the
+      // reductions of the moves after it, nor its own.
+      if (   abdada
+          && !rootNode
+          && !excludedMove
+          && moveCount > 0
+          && deferredIdx == 0
+          && deferredCount < 32
+          && searched_by_other(thisThread, pos.key_after(move), ss->ply + 1))
+      {
+          deferredMoves[deferredCount] = move;
+          deferredMoveCounts[deferredCount++] = ++moveCount;
+          continue;
+      }
+
+      ss->moveCount = moveCount = deferredIdx ? deferredMoveCounts[deferredIdx - 1] : moveCount + 1;
 
-      if (rootNode && thisThread == Threads.main() && Time.elapsed() > 3000)
+      if (rootNode && thisThread == Threads.main() && !Threads.analysing && Time.elapsed() > 3000)
           sync_cout << "info depth " << depth
                     << " currmove " << UCI::move(move, pos.is_chess960())
                     << " currmovenumber " << moveCount + thisThread->pvIdx << sync_endl;
@@ -1428,9 +1886,11 @@ namespace {
           ss->excludedMove = move;
           value = search<NonPV>(pos, ss, singularBeta - 1, singularBeta, singularDepth, cutNode);
           ss->excludedMove = MOVE_NONE;
+          STATS_INC(thisThread, SINGULAR_SEARCHES);
 
           if (value < singularBeta)
           {
+              STATS_INC(thisThread, SINGULAR_EXTENSIONS);
               extension = 1;
               singularQuietLMR = !ttCapture;
           }
@@ -1597,6 +2057,10 @@ namespace {
           // If the son is reduced and fails high it will be re-searched at full depth
           doFullDepthSearch = value > alpha && d < newDepth;
           didLMR = true;
+
+          STATS_INC(thisThread, LMR_SEARCHES);
+          if (doFullDepthSearch)
+              STATS_INC(thisThread, LMR_RESEARCHES);
       }
       else
       {
@@ -1641,7 +2105,7 @@ namespace {
       // Finished searching the move. If a stop occurred, the return value of
       // the search cannot be trusted, and we return immediately without
       // updating best move, PV and TT.
-      if (Threads.stop.load(std::memory_order_relaxed))
+      if (stopped(thisThread))
           return VALUE_ZERO;
 
       if (rootNode)
@@ -1796,6 +2260,7 @@ namespace {
     gameCycle = false;
 
     thisThread->nodes++;
+    STATS_INC(thisThread, QSEARCH_NODES);
 
     if (pos.has_game_cycle(ss->ply))
     {
@@ -1826,6 +2291,9 @@ namespace {
     // Transposition table lookup
     posKey = pos.key();
     tte = TT.probe(posKey, ss->ttHit);
+    STATS_INC(thisThread, TT_PROBES);
+    if (ss->ttHit)
+        STATS_INC(thisThread, TT_HITS);
     ttValue = ss->ttHit ? value_from_tt(tte->value(), ss->ply, pos.rule50_count()) : VALUE_NONE;
     ttBound = tte->bound();
     ttMove = ss->ttHit ? tte->move() : MOVE_NONE;
@@ -2204,6 +2672,22 @@ void MainThread::check_time() {
 }
 
 
+/// Thread::check_limits() is the check_time() of EPD analysis, where every
+/// thread stops on the movetime or nodes limit of its own position.
+
+void Thread::check_limits() {
+
+  if (--callsCnt > 0)
+      return;
+
+  callsCnt = Limits.nodes ? std::min(1024, int(Limits.nodes / 1024)) : 1024;
+
+  if (   (Limits.movetime && now() - analysisStart >= Limits.movetime)
+      || (Limits.nodes && nodes - analysisNodes >= (uint64_t)Limits.nodes))
+      limitReached = true;
+}
+
+
 /// UCI::pv() formats PV information according to the UCI protocol. UCI requires
 /// that all (if any) unsearched PV lines are sent using a previous search score.
 
@@ -2211,8 +2695,16 @@ string UCI::pv(const Position& pos, Depth depth, Value alpha, Value beta) {
 
   std::stringstream ss;
   TimePoint elapsed = Time.elapsed() + 1;
-  const RootMoves& rootMoves = pos.this_thread()->rootMoves;
-  size_t pvIdx = pos.this_thread()->pvIdx;
+  RootMoves lines;
+  std::vector<Depth> depths;
+
+  // In parallel MultiPV mode show the best lines of all the threads at the
+  // given depth, or at the last depth completed by the threads behind it.
+  if (Threads.parallelMultiPV)
+      lines = merged_lines(depth, &depths);
+
+  const RootMoves& rootMoves = Threads.parallelMultiPV ? lines : pos.this_thread()->rootMoves;
+  size_t pvIdx = Threads.parallelMultiPV ? rootMoves.size() : pos.this_thread()->pvIdx;
   size_t multiPV = std::min((size_t)Options["MultiPV"], rootMoves.size());
   uint64_t nodesSearched = Threads.nodes_searched();
   uint64_t tbHits = Threads.tb_hits() + (TB::RootInTB ? rootMoves.size() : 0);
@@ -2224,7 +2716,7 @@ string UCI::pv(const Position& pos, Depth depth, Value alpha, Value beta) {
       if (depth == 1 && !updated && i > 0)
           continue;
 
-      Depth d = updated ? depth : std::max(1, depth - 1);
+      Depth d = Threads.parallelMultiPV ? depths[i] : updated ? depth : std::max(1, depth - 1);
       Value v = updated ? rootMoves[i].score : rootMoves[i].previousScore;
       Value v2 = rootMoves[i].previousScore;
 
@@ -2268,6 +2760,37 @@ string UCI::pv(const Position& pos, Depth depth, Value alpha, Value beta) {
 }
 
 
+/// Stats::search_info() formats the rates of the search events, and the NNUE
+/// and evaluation table counters, for the "info string stats" line and the
+/// bench summary.
+
+string Search::Stats::search_info() const {
+
+  auto rate = [&](Counter c, Counter total) {
+      return 100.0 * counters[c] / std::max(counters[total], uint64_t(1));
+  };
+
+  auto hit_rate = [&](Counter hits, Counter misses) {
+      return 100.0 * counters[hits] / std::max(counters[hits] + counters[misses], uint64_t(1));
+  };
+
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(1)
+     << "qsearch "      << rate(QSEARCH_NODES, NODES) << "%"
+     << " tthits "      << rate(TT_HITS, TT_PROBES) << "%"
+     << " exphits "     << rate(EXP_HITS, EXP_PROBES) << "%"
+     << " nullcutoffs " << rate(NULL_CUTOFFS, NULL_MOVES) << "%"
+     << " lmrresearches " << rate(LMR_RESEARCHES, LMR_SEARCHES) << "%"
+     << " singularext " << rate(SINGULAR_EXTENSIONS, SINGULAR_SEARCHES) << "%"
+     << " nnueupdates " << counters[NNUE_UPDATES]
+     << " nnuerefreshes " << counters[NNUE_REFRESHES] + counters[NNUE_CACHED_REFRESHES]
+     << " pawnhits "    << hit_rate(PAWN_TABLE_HITS, PAWN_TABLE_MISSES) << "%"
+     << " materialhits " << hit_rate(MATERIAL_TABLE_HITS, MATERIAL_TABLE_MISSES) << "%";
+
+  return ss.str();
+}
+
+
 /// RootMove::extract_ponder_from_tt() is called in case we have no ponder move
 /// before exiting the search, for instance, in case we stop the search during a
 /// fail high at root. We try hard to have a ponder move to return to the GUI,
@@ -19,6 +19,7 @@
 #ifndef SEARCH_H_INCLUDED
 #define SEARCH_H_INCLUDED
 
+#include <string>
 #include <vector>
 
 #include "misc.h"
@@ -79,6 +80,42 @@ struct RootMove {
 typedef std::vector<RootMove> RootMoves;
 
 
+/// Stats counts events of the search of a thread, summed over all the threads
+/// by ThreadPool::stats(). The search counters are only updated, by STATS_INC(),
+/// in builds with stats=yes. The NNUE and evaluation table counters are always kept.
+
+struct Stats {
+
+  enum Counter {
+    NODES, QSEARCH_NODES, TT_PROBES, TT_HITS, EXP_PROBES, EXP_HITS,
+    NULL_MOVES, NULL_CUTOFFS, LMR_SEARCHES, LMR_RESEARCHES,
+    SINGULAR_SEARCHES, SINGULAR_EXTENSIONS,
+    NNUE_UPDATES, NNUE_UPDATED_PLIES, NNUE_REFRESHES, NNUE_CACHED_REFRESHES,
+    PAWN_TABLE_HITS, PAWN_TABLE_MISSES, MATERIAL_TABLE_HITS, MATERIAL_TABLE_MISSES,
+    COUNTER_NB
+  };
+
+  uint64_t& operator[](Counter c) { return counters[c]; }
+  uint64_t operator[](Counter c) const { return counters[c]; }
+
+  Stats& operator+=(const Stats& s) {
+    for (int c = 0; c < COUNTER_NB; ++c)
+        counters[c] += s.counters[c];
+    return *this;
+  }
+
+  std::string search_info() const;
+
+  uint64_t counters[COUNTER_NB] = {};
+};
+
+#if defined(USE_STATS)
+#define STATS_INC(th, counter) (++(th)->stats[Search::Stats::counter])
+#else
+#define STATS_INC(th, counter) ((void)0)
+#endif
+
+
 /// LimitsType struct stores information sent by GUI about available time to
 /// search the current move, maximum depth/time, or if we are in analysis mode.
 
@@ -86,7 +123,7 @@ struct LimitsType {
 
   LimitsType() { // Init explicitly due to broken value-initialization of non POD in MSVC
     time[WHITE] = time[BLACK] = inc[WHITE] = inc[BLACK] = npmsec = movetime = TimePoint(0);
-    movestogo = depth = mate = perft = infinite = 0;
+    movestogo = depth = mate = perft = divide = infinite = 0;
     nodes = 0;
   }
 
@@ -96,7 +133,7 @@ struct LimitsType {
 
   std::vector<Move> searchmoves;
   TimePoint time[COLOR_NB], inc[COLOR_NB], npmsec, movetime, startTime;
-  int movestogo, depth, mate, perft, infinite;
+  int movestogo, depth, mate, perft, divide, infinite;
   int64_t nodes;
 };
 
@@ -0,0 +1,50 @@
+/*
+  SugaR, a UCI chess playing engine derived from Stockfish
+  Copyright (C) 2004-2021 The Stockfish developers (see AUTHORS file)
+
+  SugaR is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  SugaR is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <fstream>
+#include <iostream>
+
+#include "bitboard.h"
+
+// tablegen is run by the Makefile before the engine is built. It computes the
+// KPK bitbase and the magic bitboards as the engine does at startup, and writes
+// them to kpk.bin and magics.bin, which are then embedded in the engine binary.
+
+namespace {
+
+  template<typename F>
+  bool write(const char* fileName, F writer) {
+
+    std::ofstream file(fileName, std::ios::binary);
+    writer(file);
+
+    if (!file)
+        std::cerr << "tablegen: failed to write " << fileName << std::endl;
+
+    return bool(file);
+  }
+
+} // namespace
+
+int main() {
+
+  Bitboards::init();
+  Bitbases::init();
+
+  return write("kpk.bin", Bitbases::write) && write("magics.bin", Bitboards::write) ? 0 : 1;
+}
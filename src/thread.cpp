@@ -28,6 +28,28 @@
 
 ThreadPool Threads; // Global object
 
+namespace {
+
+  // spin_until() busy waits, yielding to the other threads, until the given
+  // condition is true or 'Spin Wait' milliseconds have passed.
+  template<typename Predicate>
+  bool spin_until(Predicate done) {
+
+    TimePoint end = now() + Threads.spinWait;
+
+    while (!done())
+    {
+        if (now() >= end)
+            return false;
+
+        std::this_thread::yield();
+    }
+
+    return true;
+  }
+
+} // namespace
+
 
 /// Thread constructor launches the thread and waits until it goes to sleep
 /// in idle_loop(). Note that 'searching' and 'exit' should be already set.
@@ -59,33 +81,44 @@ void Thread::clear() {
   mainHistory.fill(0);
   lowPlyHistory.fill(0);
   captureHistory.fill(0);
-
-  for (bool inCheck : { false, true })
-      for (StatsType c : { NoCaptures, Captures })
-      {
-          for (auto& to : continuationHistory[inCheck][c])
-                for (auto& h : to)
-                      h->fill(0);
-          continuationHistory[inCheck][c][NO_PIECE][0]->fill(Search::CounterMovePruneThreshold - 1);
-      }
+  refreshTable.clear();
+
+  // A shared continuation history is cleared by the thread owning it
+  if (ownContinuationHistory)
+      for (bool inCheck : { false, true })
+          for (StatsType c : { NoCaptures, Captures })
+          {
+              for (auto& to : continuationHistory[inCheck][c])
+                    for (auto& h : to)
+                          h->fill(0);
+              continuationHistory[inCheck][c][NO_PIECE][0]->fill(Search::CounterMovePruneThreshold - 1);
+          }
 }
 
 
-/// Thread::start_searching() wakes up the thread that will start the search
+/// Thread::start_searching() wakes up the thread that will start the search.
+/// A thread still spinning in idle_loop() sees the flag without any call to
+/// the OS, so with "Spin Wait" all the threads start at once.
 
 void Thread::start_searching() {
 
   std::lock_guard<std::mutex> lk(mutex);
   searching = true;
-  cv.notify_one(); // Wake up the thread in idle_loop()
+
+  if (sleeping)
+      cv.notify_one(); // Wake up the thread in idle_loop()
 }
 
 
 /// Thread::wait_for_search_finished() blocks on the condition variable
-/// until the thread has finished searching.
+/// until the thread has finished searching, after spinning for a while with
+/// "Spin Wait".
 
 void Thread::wait_for_search_finished() {
 
+  if (Threads.spinWait && spin_until([&]{ return !searching; }))
+      return;
+
   std::unique_lock<std::mutex> lk(mutex);
   cv.wait(lk, [&]{ return !searching; });
 }
@@ -109,14 +142,29 @@ void Thread::idle_loop() {
       std::unique_lock<std::mutex> lk(mutex);
       searching = false;
       cv.notify_one(); // Wake up anyone waiting for search finished
-      cv.wait(lk, [&]{ return searching; });
+
+      // With "Spin Wait" the thread spins before sleeping, so that a search
+      // started soon after does not wait for the OS to wake up the thread.
+      if (Threads.spinWait)
+      {
+          lk.unlock();
+          spin_until([&]{ return searching.load(); });
+          lk.lock();
+      }
+
+      sleeping = true;
+      cv.wait(lk, [&]{ return searching.load(); });
+      sleeping = false;
 
       if (exit)
           return;
 
       lk.unlock();
 
-      search();
+      if (Threads.analysing)
+          analyse();
+      else
+          search();
   }
 }
 
@@ -138,6 +186,25 @@ void ThreadPool::set(size_t requested) {
 
       while (size() < requested)
           push_back(new Thread(size()));
+
+      // The continuation history is shared by groups of consecutive threads,
+      // which are bound to the same NUMA node when the threads are bound.
+      size_t sharing = size_t(Options["History Sharing"]);
+
+      for (size_t i = 0; i < size(); ++i)
+      {
+          Thread* th = (*this)[i];
+
+          if (i % sharing == 0)
+          {
+              th->ownContinuationHistory.reset(new ContinuationHistory[2][2]);
+              th->continuationHistory = th->ownContinuationHistory.get();
+          }
+          else
+              th->continuationHistory = (*this)[i - i % sharing]->continuationHistory;
+      }
+
+      resize_eval_tables();
       clear();
 
       // Reallocate the hash with the new threadpool size
@@ -209,8 +276,16 @@ void ThreadPool::start_thinking(Position& pos, StateListPtr& states,
   for (Thread* th : *this)
   {
       th->nodes = th->tbHits = th->nmpGuard = th->bestMoveChanges = 0;
+      th->stats = Search::Stats();
+      th->refreshTable.updates = th->refreshTable.updatedPlies = 0;
+      th->refreshTable.refreshes = th->refreshTable.cachedRefreshes = 0;
+      th->pawnsTable.hits = th->pawnsTable.misses = 0;
+      th->materialTable.hits = th->materialTable.misses = 0;
       th->rootDepth = th->completedDepth = 0;
       th->rootMoves = rootMoves;
+      th->completedLines.clear();
+      th->shareLines = false;
+      th->partialRoot = false;
       th->rootPos.set(pos.fen(), pos.is_chess960(), &th->rootState, th);
       th->rootState = setupStates->back();
   }
@@ -224,13 +299,18 @@ Thread* ThreadPool::get_best_thread() const {
     std::map<Move, int64_t> votes;
     Value minScore = VALUE_NONE;
 
-    // Find minimum score of all threads
+    // Find minimum score of all threads. The threads that have searched only
+    // a part of the root moves do not take part in the vote.
     for (Thread* th: *this)
-        minScore = std::min(minScore, th->rootMoves[0].score);
+        if (!th->partialRoot)
+            minScore = std::min(minScore, th->rootMoves[0].score);
 
     // Vote according to score and depth, and select the best thread
     for (Thread* th : *this)
     {
+        if (th->partialRoot)
+            continue;
+
         votes[th->rootMoves[0].pv[0]] +=
             (th->rootMoves[0].score - minScore + 14) * int(th->completedDepth);
 
@@ -250,6 +330,80 @@ Thread* ThreadPool::get_best_thread() const {
 }
 
 
+/// ThreadPool::start_analysis() wakes up the main thread to analyse the given
+/// EPD positions, each of them searched by a single thread with the given limits.
+/// The threads share the TT but have their own root position. Returns immediately.
+
+void ThreadPool::start_analysis(const std::vector<std::string>& epdLines,
+                                const Search::LimitsType& limits, size_t multiPV) {
+
+  main()->wait_for_search_finished();
+
+  main()->stopOnPonderhit = stop = false;
+  increaseDepth = true;
+  main()->ponder = false;
+  parallelMultiPV = false;
+  Search::Limits = limits;
+  epds = epdLines;
+  nextEpd = 0;
+  analysisPV = multiPV;
+  analysing = true;
+
+  for (Thread* th : *this)
+  {
+      th->nodes = th->tbHits = th->nmpGuard = th->bestMoveChanges = 0;
+      th->stats = Search::Stats();
+      th->refreshTable.updates = th->refreshTable.updatedPlies = 0;
+      th->refreshTable.refreshes = th->refreshTable.cachedRefreshes = 0;
+      th->pawnsTable.hits = th->pawnsTable.misses = 0;
+      th->materialTable.hits = th->materialTable.misses = 0;
+  }
+
+  main()->start_searching();
+}
+
+
+/// ThreadPool::resize_eval_tables() sizes the evaluation tables of each thread
+/// as set by the "Pawn Hash" and "Material Hash" (KB) options, which also clears
+/// them.
+
+void ThreadPool::resize_eval_tables() {
+
+  main()->wait_for_search_finished();
+
+  for (Thread* th : *this)
+  {
+      th->pawnsTable.resize(size_t(Options["Pawn Hash"]));
+      th->materialTable.resize(size_t(Options["Material Hash"]));
+  }
+}
+
+
+/// ThreadPool::stats() sums the search statistics of all the threads, with
+/// their node counts and the counters of their evaluation tables.
+
+Search::Stats ThreadPool::stats() const {
+
+  Search::Stats total;
+
+  for (Thread* th : *this)
+  {
+      total += th->stats;
+      total[Search::Stats::NODES]                 += th->nodes;
+      total[Search::Stats::NNUE_UPDATES]          += th->refreshTable.updates;
+      total[Search::Stats::NNUE_UPDATED_PLIES]    += th->refreshTable.updatedPlies;
+      total[Search::Stats::NNUE_REFRESHES]        += th->refreshTable.refreshes;
+      total[Search::Stats::NNUE_CACHED_REFRESHES] += th->refreshTable.cachedRefreshes;
+      total[Search::Stats::PAWN_TABLE_HITS]       += th->pawnsTable.hits;
+      total[Search::Stats::PAWN_TABLE_MISSES]     += th->pawnsTable.misses;
+      total[Search::Stats::MATERIAL_TABLE_HITS]   += th->materialTable.hits;
+      total[Search::Stats::MATERIAL_TABLE_MISSES] += th->materialTable.misses;
+  }
+
+  return total;
+}
+
+
 /// Start non-main threads
 
 void ThreadPool::start_searching() {
@@ -21,7 +21,9 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -43,20 +45,26 @@ class Thread {
   std::mutex mutex;
   std::condition_variable cv;
   size_t idx;
-  bool exit = false, searching = true; // Set before starting std::thread
+  bool exit = false, sleeping = false;
+  std::atomic_bool searching{true}; // Set before starting std::thread
   NativeThread stdThread;
 
 public:
   explicit Thread(size_t);
   virtual ~Thread();
   virtual void search();
+  virtual void analyse();
+  bool search_position();
+  void check_limits();
   void clear();
   void idle_loop();
   void start_searching();
   void wait_for_search_finished();
+  bool is_searching() const { return searching; }
 
   Pawns::Table pawnsTable;
   Material::Table materialTable;
+  Eval::NNUE::RefreshTable refreshTable;
   size_t pvIdx, pvLast;
   uint64_t ttHitAverage;
   int selDepth;
@@ -71,9 +79,23 @@ public:
   ButterflyHistory mainHistory;
   LowPlyHistory lowPlyHistory;
   CapturePieceToHistory captureHistory;
-  ContinuationHistory continuationHistory[2][2];
-  bool fullSearch;
+  ContinuationHistory (*continuationHistory)[2]; // [inCheck][captureOrPromotion]
+  std::unique_ptr<ContinuationHistory[][2]> ownContinuationHistory;
+  bool fullSearch, partialRoot;
   Score contempt;
+  Search::Stats stats;
+  int callsCnt;
+
+  // EPD analysis: the start of the search of the position of the thread
+  TimePoint analysisStart;
+  uint64_t analysisNodes;
+  bool limitReached;
+
+  // Parallel MultiPV: whether the thread searches a share of the root moves,
+  // and the lines of each of its completed iterations, indexed by depth
+  std::mutex linesMutex;
+  bool shareLines;
+  std::vector<Search::RootMoves> completedLines;
 };
 
 
@@ -84,12 +106,12 @@ struct MainThread : public Thread {
   using Thread::Thread;
 
   void search() override;
+  void analyse() override;
   void check_time();
 
   double previousTimeReduction;
   Value bestPreviousScore;
   Value iterValue[4];
-  int callsCnt;
   bool stopOnPonderhit;
   std::atomic_bool ponder;
 };
@@ -102,18 +124,30 @@ struct MainThread : public Thread {
 struct ThreadPool : public std::vector<Thread*> {
 
   void start_thinking(Position&, StateListPtr&, const Search::LimitsType&, bool = false);
+  void start_analysis(const std::vector<std::string>&, const Search::LimitsType&, size_t = 0);
   void clear();
   void set(size_t);
   void setFull(size_t);
+  void resize_eval_tables();
 
   MainThread* main()        const { return static_cast<MainThread*>(front()); }
   uint64_t nodes_searched() const { return accumulate(&Thread::nodes); }
   uint64_t tb_hits()        const { return accumulate(&Thread::tbHits); }
   Thread* get_best_thread() const;
+  Search::Stats stats() const;
   void start_searching();
   void wait_for_search_finished() const;
 
   std::atomic_bool stop, increaseDepth;
+  bool parallelMultiPV;
+  TimePoint spinWait; // Time the idle threads spin before sleeping, see idle_loop()
+
+  // EPD analysis: the positions are dealt out to the threads one at a time,
+  // searched with 'analysisPV' lines, or MultiPV if zero.
+  bool analysing;
+  size_t analysisPV;
+  std::vector<std::string> epds;
+  std::atomic<size_t> nextEpd;
 
 private:
   StateListPtr setupStates;
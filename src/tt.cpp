@@ -388,9 +388,15 @@ void TranspositionTable::load_epd_to_hash() {
 
 			//extract and set position
 			std::size_t i = x[0].find("acd"); //depth searched. Is after the fen string
+			std::string_view fen = std::string_view(x[0]).substr(0, i);
+
+			//skip the malformed lines, which set() does not check
+			if (i == std::string::npos || !Position::is_valid_fen(fen))
+				continue;
+
 			StateListPtr states(new std::deque<StateInfo>(1));
-			sync_cout << x[0].substr(0, i) << sync_endl;
-			pos.set(x[0].substr(0, i), Options["UCI_Chess960"], &states->back(), Threads.main());
+			sync_cout << fen << sync_endl;
+			pos.set(fen, Options["UCI_Chess960"], &states->back(), Threads.main());
 			
 			//depth
 			depth = std::stoi(x[0].substr(i + 4));
@@ -35,6 +35,9 @@
 ///
 /// -DUSE_PEXT    | Add runtime support for use of pext asm-instruction. Works
 ///               | only in 64-bit mode and requires hardware with pext support.
+///
+/// -DUSE_SOFT_PEXT | With USE_PEXT, computes pext in software instead. Used by
+///               | tablegen, which runs on the build machine.
 
 #include <cassert>
 #include <cctype>
@@ -76,7 +79,16 @@
 #  include <xmmintrin.h> // Intel and Microsoft header for _mm_prefetch()
 #endif
 
-#if defined(USE_PEXT)
+#if defined(USE_PEXT) && defined(USE_SOFT_PEXT)
+constexpr uint64_t soft_pext(uint64_t b, uint64_t m) {
+  uint64_t r = 0;
+  for (uint64_t bit = 1; m; bit <<= 1, m &= m - 1)
+      if (b & m & (0 - m))
+          r |= bit;
+  return r;
+}
+#  define pext(b, m) soft_pext(b, m)
+#elif defined(USE_PEXT)
 #  include <immintrin.h> // Header for _pext_u64() intrinsic
 #  define pext(b, m) _pext_u64(b, m)
 #else
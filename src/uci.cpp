@@ -18,13 +18,21 @@
 
 #include <cassert>
 #include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <thread>
 
+#include "endgame.h"
 #include "evaluate.h"
+#include "idea.h"
 #include "movegen.h"
 #include "position.h"
+#include "psqt.h"
 #include "search.h"
 #include "thread.h"
 #include "timeman.h"
@@ -38,6 +46,8 @@ using namespace std;
 
 extern vector<string> setup_bench(const Position&, istream&);
 
+vector<pair<string, uint64_t>> UCI::startupTimes;
+
 namespace {
 
   // FEN string of the initial position, normal chess
@@ -99,6 +109,192 @@ namespace {
   }
 
 
+  // evalbatch() scores all the positions of an EPD file with the NNUE network.
+  // The file is split among the search threads, each of them evaluating its
+  // share in batches, and the positions are printed in input order as EPD with
+  // the evaluation in centipawns from the side to move in a "ce" opcode. The
+  // malformed lines are reported and skipped.
+
+  void evalbatch(istringstream& is) {
+
+    string fileName, line;
+    vector<string> fens;
+
+    is >> fileName;
+    ifstream file(fileName);
+
+    if (!file.is_open())
+    {
+        sync_cout << "info string Unable to open file " << fileName << sync_endl;
+        return;
+    }
+
+    // The first four fields are the position, the operations that may follow
+    // are not needed. set() does not check its input, so report the malformed
+    // lines instead of evaluating them.
+    while (getline(file, line))
+    {
+        istringstream ls(line);
+        string token, fen;
+
+        for (int field = 0; field < 4 && ls >> token; ++field)
+            fen += token + " ";
+
+        if (fen.empty())
+            continue;
+
+        if (Position::is_valid_fen(fen))
+            fens.push_back(fen);
+        else
+            sync_cout << "info string Invalid EPD: " << line << sync_endl;
+    }
+
+    Eval::NNUE::verify();
+
+    if (!Eval::useNNUE)
+    {
+        sync_cout << "info string evalbatch needs the NNUE evaluation enabled" << sync_endl;
+        return;
+    }
+
+    // The workers use the refresh tables of the search threads
+    Threads.main()->wait_for_search_finished();
+
+    vector<Value> values(fens.size());
+    vector<std::thread> workers;
+    bool chess960 = Options["UCI_Chess960"];
+
+    for (size_t t = 0; t < Threads.size(); ++t)
+        workers.emplace_back([&, t]() {
+
+            constexpr size_t BatchSize = 256;
+            unique_ptr<Position[]> positions(new Position[BatchSize]);
+            unique_ptr<StateInfo[]> states(new StateInfo[BatchSize]);
+            const Position* batch[BatchSize];
+
+            size_t first = t * fens.size() / Threads.size();
+            size_t last = (t + 1) * fens.size() / Threads.size();
+
+            for (size_t i = first; i < last; i += BatchSize)
+            {
+                size_t n = min(BatchSize, last - i);
+                for (size_t j = 0; j < n; ++j)
+                {
+                    positions[j].set(fens[i + j], chess960, &states[j], Threads[t]);
+                    batch[j] = &positions[j];
+                }
+                Eval::NNUE::evaluate(batch, n, &values[i]);
+            }
+        });
+
+    for (std::thread& th : workers)
+        th.join();
+
+    sync_cout;
+
+    for (size_t i = 0; i < fens.size(); ++i)
+        cout << fens[i] << "ce " << values[i] * 100 / PawnValueEg << (i + 1 < fens.size() ? ";\n" : ";");
+
+    cout << sync_endl;
+  }
+
+
+  // analyse() searches the positions of an EPD file, given as the first argument,
+  // with a depth, nodes or movetime limit per position. Each thread searches its
+  // own position, and the results are written as EPD lines as the searches end.
+
+  void analyse(istringstream& is) {
+
+    string fileName, limit, line;
+    int64_t value = 0;
+    Search::LimitsType limits;
+
+    is >> fileName >> limit >> value;
+
+    if      (limit == "depth")    limits.depth = int(value);
+    else if (limit == "nodes")    limits.nodes = value;
+    else if (limit == "movetime") limits.movetime = value;
+
+    if (value <= 0 || (!limits.depth && !limits.nodes && !limits.movetime))
+    {
+        sync_cout << "info string Usage: analyse <epdfile> depth|nodes|movetime <value>" << sync_endl;
+        return;
+    }
+
+    ifstream file(fileName);
+
+    if (!file.is_open())
+    {
+        sync_cout << "info string Unable to open file " << fileName << sync_endl;
+        return;
+    }
+
+    vector<string> epds;
+    while (getline(file, line))
+        if (line.find_first_not_of(" \t\r") != string::npos)
+            epds.push_back(line);
+
+    limits.startTime = now();
+    Threads.start_analysis(epds, limits);
+    Threads.main()->wait_for_search_finished();
+
+    TimePoint elapsed = now() - limits.startTime + 1; // Ensure positivity to avoid a 'divide by zero'
+    uint64_t nodes = Threads.nodes_searched();
+
+    cerr << "\n==========================="
+         << "\nPositions       : " << epds.size()
+         << "\nTotal time (ms) : " << elapsed
+         << "\nNodes searched  : " << nodes
+         << "\nNodes/second    : " << 1000 * nodes / elapsed << endl;
+  }
+
+
+  // idea() grows the analysis tree of the current position, see idea.h. The
+  // depth of the searches is needed, the width, number of leaves to search and
+  // file of the tree are optional.
+
+  void idea(Position& pos, istringstream& is) {
+
+    string token, fileName;
+    Depth depth = 0;
+    size_t width = 3, leaves = 100;
+
+    while (is >> token)
+        if      (token == "depth")  is >> depth;
+        else if (token == "width")  is >> width;
+        else if (token == "leaves") is >> leaves;
+        else if (token == "file")   is >> fileName;
+
+    if (depth <= 0 || !width)
+    {
+        sync_cout << "info string Usage: idea depth <depth> [width <moves>] [leaves <searches>] [file <name>]" << sync_endl;
+        return;
+    }
+
+    Idea::build(pos, depth, width, leaves, fileName);
+  }
+
+
+  // export_blob() writes the loaded network as a blob in the memory layout of
+  // this build. Engine processes with EvalFile set to the blob map it read-only,
+  // so a single copy of the weights is shared among them.
+
+  void export_blob(istringstream& is) {
+
+    string name;
+
+    if (!(is >> name))
+        name = string(Options["EvalFile"]) + ".blob";
+
+    Eval::NNUE::verify();
+
+    if (Eval::useNNUE && Eval::NNUE::export_blob(name))
+        sync_cout << "info string Network saved to " << name << sync_endl;
+    else
+        sync_cout << "info string Failed to export the network to " << name << sync_endl;
+  }
+
+
   // setoption() is called when engine receives the "setoption" UCI command. The
   // function updates the UCI option ("name") to the given value ("value").
 
@@ -150,6 +346,7 @@ namespace {
         else if (token == "movetime")  is >> limits.movetime;
         else if (token == "mate")      is >> limits.mate;
         else if (token == "perft")     is >> limits.perft;
+        else if (token == "divide")    limits.divide = 1;
         else if (token == "infinite")  limits.infinite = 1;
         else if (token == "ponder")    ponderMode = true;
 
@@ -157,6 +354,515 @@ namespace {
   }
 
 
+  // bench_positions() reads the positions of a bench file, letting setup_bench()
+  // apply their Chess960 setting.
+
+  void bench_positions(const Position& current, const string& fenFile,
+                       vector<string>& fens, vector<bool>& chess960) {
+
+    string token, cmd;
+    istringstream is("16 1 1 " + fenFile);
+
+    for (const auto& line : setup_bench(current, is))
+    {
+        istringstream ls(line);
+        ls >> cmd;
+
+        if (cmd == "setoption" && line.find("UCI_Chess960") != string::npos)
+            setoption(ls);
+
+        else if (cmd == "position" && (ls >> token) && token == "fen")
+        {
+            fens.push_back(line.substr(line.find("fen ") + 4));
+            chess960.push_back(Options["UCI_Chess960"]);
+        }
+    }
+  }
+
+
+  // bench_arg() parses a numeric argument of a bench sub-mode. An argument which
+  // is not a number of at least minValue is reported with the usage of the
+  // sub-mode, and value is then left unchanged.
+
+  bool bench_arg(const string& token, int& value, int minValue, const string& usage) {
+
+    istringstream is(token);
+    int v;
+
+    if (!(is >> v) || !is.eof() || v < minValue)
+    {
+        sync_cout << "info string Invalid argument " << token << ". Usage: " << usage << sync_endl;
+        return false;
+    }
+
+    value = v;
+    return true;
+  }
+
+
+  // bench_eval() is called for "bench eval [iterations] [fenFile]". It times
+  // each stage of the static evaluation on the bench positions, the classical
+  // evaluation and, when NNUE is in use, the network evaluation, and prints
+  // the nanoseconds and CPU cycles per call. Positions in check are skipped,
+  // as the search never evaluates them.
+
+  void bench_eval(Position& current, istream& args) {
+
+    string token;
+    int iterations = 1000;
+
+    if ((args >> token) && !bench_arg(token, iterations, 1, "bench eval [iterations] [fenFile]"))
+        return;
+
+    string fenFile = (args >> token) ? token : "default";
+    vector<string> fens;
+    vector<bool> chess960;
+
+    bench_positions(current, fenFile, fens, chess960);
+
+    Eval::NNUE::verify();
+
+    vector<Position> positions(fens.size());
+    vector<StateInfo> states(fens.size());
+    vector<Position*> list;
+
+    for (size_t i = 0; i < fens.size(); ++i)
+    {
+        positions[i].set(fens[i], chess960[i], &states[i], Threads.main());
+        if (!positions[i].checkers())
+            list.push_back(&positions[i]);
+    }
+
+    Eval::StageTimings timings = Eval::benchmark(list.data(), list.size(), iterations);
+
+    cerr << "\n==========================="
+         << "\nPositions       : " << list.size() << " x " << iterations << " iterations\n\n"
+         << left << setw(30) << "Stage" << right << setw(12) << "ns/call" << setw(14) << "cycles/call" << "\n"
+         << fixed << setprecision(1);
+
+    for (const auto& [name, watch] : timings)
+        cerr << left << setw(30) << name << right
+             << setw(12) << double(watch.nanoseconds) / max(watch.calls, uint64_t(1))
+             << setw(14) << double(watch.cycles) / max(watch.calls, uint64_t(1)) << "\n";
+
+    cerr << defaultfloat << endl;
+  }
+
+
+  // bench_moves() is called for "bench moves [iterations] [fenFile]". It times
+  // do_move() and undo_move() of all the legal moves of the bench positions,
+  // and the null move of the positions not in check, and prints the
+  // nanoseconds and CPU cycles per pair of calls.
+
+  void bench_moves(Position& current, istream& args) {
+
+    string token;
+    int iterations = 1000;
+
+    if ((args >> token) && !bench_arg(token, iterations, 1, "bench moves [iterations] [fenFile]"))
+        return;
+
+    string fenFile = (args >> token) ? token : "default";
+    vector<string> fens;
+    vector<bool> chess960;
+
+    bench_positions(current, fenFile, fens, chess960);
+
+    Stopwatch moves, nullMoves;
+    StateInfo rootState, st;
+
+    for (size_t i = 0; i < fens.size(); ++i)
+    {
+        Position pos;
+        pos.set(fens[i], chess960[i], &rootState, Threads.main());
+
+        vector<pair<Move, bool>> legalMoves;
+        for (const auto& m : MoveList<LEGAL>(pos))
+            legalMoves.emplace_back(m, pos.gives_check(m));
+
+        moves.start();
+        for (int it = 0; it < iterations; ++it)
+            for (const auto& [m, givesCheck] : legalMoves)
+            {
+                pos.do_move(m, st, givesCheck);
+                pos.undo_move(m);
+            }
+        moves.stop(iterations * legalMoves.size());
+
+        if (pos.checkers())
+            continue;
+
+        nullMoves.start();
+        for (int it = 0; it < iterations; ++it)
+        {
+            pos.do_null_move(st);
+            pos.undo_null_move();
+        }
+        nullMoves.stop(iterations);
+    }
+
+    cerr << "\n==========================="
+         << "\nPositions       : " << fens.size() << " x " << iterations << " iterations"
+         << "\nStateInfo       : " << sizeof(StateInfo) << " bytes\n\n"
+         << left << setw(30) << "Stage" << right << setw(12) << "ns/call" << setw(14) << "cycles/call" << "\n"
+         << fixed << setprecision(1);
+
+    for (const auto& [name, watch] : { make_pair("do_move + undo_move", moves),
+                                       make_pair("do_null_move + undo_null_move", nullMoves) })
+        cerr << left << setw(30) << name << right
+             << setw(12) << double(watch.nanoseconds) / max(watch.calls, uint64_t(1))
+             << setw(14) << double(watch.cycles) / max(watch.calls, uint64_t(1)) << "\n";
+
+    cerr << defaultfloat << endl;
+  }
+
+
+  // bench_fen() is called for "bench fen [iterations] [fenFile]". It times the
+  // validation of the FENs of the bench positions and the setting up of these
+  // positions, and prints the nanoseconds and CPU cycles per FEN and the
+  // number of FENs per second.
+
+  void bench_fen(Position& current, istream& args) {
+
+    string token;
+    int iterations = 100000;
+
+    if ((args >> token) && !bench_arg(token, iterations, 1, "bench fen [iterations] [fenFile]"))
+        return;
+
+    string fenFile = (args >> token) ? token : "default";
+    vector<string> fens;
+    vector<bool> chess960;
+
+    bench_positions(current, fenFile, fens, chess960);
+
+    for (string& fen : fens)
+        fen = fen.substr(0, fen.find(" moves"));
+
+    Stopwatch validation, setup;
+    Position pos;
+    StateInfo st;
+    size_t valid = 0;
+
+    validation.start();
+    for (int it = 0; it < iterations; ++it)
+        for (const string& fen : fens)
+            valid += Position::is_valid_fen(fen);
+    validation.stop(iterations * fens.size());
+
+    setup.start();
+    for (int it = 0; it < iterations; ++it)
+        for (size_t i = 0; i < fens.size(); ++i)
+            pos.set(fens[i], chess960[i], &st, Threads.main());
+    setup.stop(iterations * fens.size());
+
+    cerr << "\n==========================="
+         << "\nPositions       : " << fens.size() << " x " << iterations << " iterations"
+         << "\nValid FENs      : " << valid / iterations << "\n\n"
+         << left << setw(30) << "Stage" << right << setw(12) << "ns/FEN" << setw(14) << "cycles/FEN"
+         << setw(12) << "M FEN/s" << "\n"
+         << fixed << setprecision(1);
+
+    for (const auto& [name, watch] : { make_pair("Position::is_valid_fen()", validation),
+                                       make_pair("Position::set()", setup) })
+        cerr << left << setw(30) << name << right
+             << setw(12) << double(watch.nanoseconds) / max(watch.calls, uint64_t(1))
+             << setw(14) << double(watch.cycles) / max(watch.calls, uint64_t(1))
+             << setw(12) << setprecision(2) << 1000.0 * watch.calls / max(watch.nanoseconds, uint64_t(1))
+             << setprecision(1) << "\n";
+
+    cerr << defaultfloat << endl;
+  }
+
+
+  // bench_history() is called for "bench history [depth] [threads...]". For each
+  // number of threads (64, 128 and 256 by default) it searches the bench
+  // positions to the given depth with a continuation history per thread, then
+  // with one shared by all the threads, and prints the time to clear the
+  // histories, the time to reach the depth and the speed of each run. The
+  // options are restored afterwards.
+
+  void bench_history(Position& pos, istream& args, StateListPtr& states) {
+
+    const string usage = "bench history [depth] [threads...]";
+    string token;
+    Depth depth = 13;
+    vector<size_t> threadCounts;
+
+    if ((args >> token) && !bench_arg(token, depth, 1, usage))
+        return;
+
+    for (int threads; args >> token; threadCounts.push_back(threads))
+        if (!bench_arg(token, threads, 1, usage))
+            return;
+
+    if (threadCounts.empty())
+        threadCounts = { 64, 128, 256 };
+
+    const size_t threadsDefault = size_t(Options["Threads"]);
+    const size_t sharingDefault = size_t(Options["History Sharing"]);
+
+    ostringstream report;
+    report << left << setw(10) << "Threads" << setw(10) << "Sharing" << right
+           << setw(12) << "Clear (ms)" << setw(14) << "Depth (ms)"
+           << setw(14) << "Nodes" << setw(12) << "Nodes/s" << "\n";
+
+    for (size_t threads : threadCounts)
+        for (size_t sharing : { size_t(1), threads })
+        {
+            // Shrink the pool first, setup_bench() sets the number of threads
+            Options["Threads"] = string("1");
+            Options["History Sharing"] = to_string(sharing);
+
+            istringstream is("16 " + to_string(threads) + " " + to_string(depth));
+            TimePoint clearTime = 0, searchTime = 0;
+            uint64_t nodes = 0;
+
+            for (const auto& cmd : setup_bench(pos, is))
+            {
+                istringstream cs(cmd);
+                cs >> skipws >> token;
+
+                if (token == "go")
+                {
+                    TimePoint start = now();
+                    go(pos, cs, states);
+                    Threads.main()->wait_for_search_finished();
+                    searchTime += now() - start;
+                    nodes += Threads.nodes_searched();
+                }
+                else if (token == "setoption")  setoption(cs);
+                else if (token == "position")   position(pos, cs, states);
+                else if (token == "ucinewgame")
+                {
+                    TimePoint start = now();
+                    Search::clear();
+                    clearTime += now() - start;
+                }
+            }
+
+            report << left << setw(10) << threads << setw(10) << sharing << right
+                   << setw(12) << clearTime << setw(14) << searchTime
+                   << setw(14) << nodes << setw(12) << 1000 * nodes / (searchTime + 1) << "\n";
+        }
+
+    Options["Threads"] = to_string(threadsDefault);
+    Options["History Sharing"] = to_string(sharingDefault);
+
+    cerr << "\n===========================\n" << report.str() << endl;
+  }
+
+
+  // bench_tables() is called for "bench tables [depth] [sizes...]". It searches
+  // the bench positions to the given depth with the classical evaluation, once
+  // for each size in KB of the pawn table (16 KB to 64 MB by default) with the
+  // material table at its default size, then once for each size of the material
+  // table with the pawn table at its default size, and prints the speed and the
+  // hit rate of each run. The options are restored afterwards.
+
+  void bench_tables(Position& pos, istream& args, StateListPtr& states) {
+
+    const string usage = "bench tables [depth] [sizes...]";
+    string token;
+    Depth depth = 13;
+    vector<string> sizes;
+
+    if ((args >> token) && !bench_arg(token, depth, 1, usage))
+        return;
+
+    for (int size; args >> token; sizes.push_back(to_string(size)))
+        if (!bench_arg(token, size, 1, usage))
+            return;
+
+    if (sizes.empty())
+        sizes = { "16", "64", "256", "1024", "4096", "16384", "65536" };
+
+    const string pawnDefault     = to_string(int(Options["Pawn Hash"]));
+    const string materialDefault = to_string(int(Options["Material Hash"]));
+
+    ostringstream report;
+    report << left << setw(10) << "Table" << right << setw(10) << "KB" << setw(10) << "Entries"
+           << setw(12) << "Time (ms)" << setw(12) << "Nodes/s" << setw(10) << "Hits %" << "\n"
+           << fixed << setprecision(2);
+
+    for (const string name : { "Pawn Hash", "Material Hash" })
+        for (const string& size : sizes)
+        {
+            Options["Pawn Hash"]     = name == "Pawn Hash"     ? size : pawnDefault;
+            Options["Material Hash"] = name == "Material Hash" ? size : materialDefault;
+
+            istringstream is("16 1 " + to_string(depth) + " default depth classical");
+            TimePoint elapsed = 0;
+            uint64_t nodes = 0;
+            Search::Stats stats;
+
+            for (const auto& cmd : setup_bench(pos, is))
+            {
+                istringstream cs(cmd);
+                cs >> skipws >> token;
+
+                if (token == "go")
+                {
+                    TimePoint start = now();
+                    go(pos, cs, states);
+                    Threads.main()->wait_for_search_finished();
+                    elapsed += now() - start;
+                    nodes += Threads.nodes_searched();
+                    stats += Threads.stats();
+                }
+                else if (token == "setoption")  setoption(cs);
+                else if (token == "position")   position(pos, cs, states);
+                else if (token == "ucinewgame") Search::clear();
+            }
+
+            using S = Search::Stats;
+            bool pawns = name == "Pawn Hash";
+            uint64_t hits   = stats[pawns ? S::PAWN_TABLE_HITS : S::MATERIAL_TABLE_HITS];
+            uint64_t misses = stats[pawns ? S::PAWN_TABLE_MISSES : S::MATERIAL_TABLE_MISSES];
+            size_t entries  = pawns ? Threads.main()->pawnsTable.size() : Threads.main()->materialTable.size();
+
+            report << left << setw(10) << (pawns ? "Pawns" : "Material") << right
+                   << setw(10) << size << setw(10) << entries << setw(12) << elapsed
+                   << setw(12) << 1000 * nodes / (elapsed + 1)
+                   << setw(10) << 100.0 * hits / max(hits + misses, uint64_t(1)) << "\n";
+        }
+
+    Options["Pawn Hash"] = pawnDefault;
+    Options["Material Hash"] = materialDefault;
+
+    cerr << "\n===========================\n" << report.str() << endl;
+  }
+
+
+  // bench_startup() is called for "bench startup [iterations]". It prints the
+  // milliseconds taken by each initialization step of main() when the engine
+  // started, then runs again those which can be repeated, the given number of
+  // times, and prints their milliseconds per run.
+
+  void bench_startup(istream& args) {
+
+    string token;
+    int iterations = 10;
+
+    if ((args >> token) && !bench_arg(token, iterations, 1, "bench startup [iterations]"))
+        return;
+
+    size_t threads = size_t(Options["Threads"]);
+
+    map<string, function<void()>> repeatable = {
+        { "PSQT::init()",       PSQT::init },
+        { "Bitboards::init()",  Bitboards::init },
+        { "Position::init()",   Position::init },
+        { "Bitbases::init()",   Bitbases::init },
+        { "Endgames::init()",   Endgames::init },
+        { "Threads.set()",      [&]{ Threads.set(threads); } },
+        { "Search::clear()",    Search::clear }
+    };
+
+    double startup = 0, rerun = 0;
+
+    cerr << "\n==========================="
+         << "\nIterations      : " << iterations
+         << "\nThreads         : " << threads << "\n\n"
+         << left << setw(24) << "Step" << right << setw(14) << "Startup (ms)" << setw(12) << "ms/run" << "\n"
+         << fixed << setprecision(3);
+
+    for (const auto& [name, nanoseconds] : UCI::startupTimes)
+    {
+        cerr << left << setw(24) << name << right << setw(14) << nanoseconds / 1e6;
+        startup += nanoseconds / 1e6;
+
+        if (repeatable.count(name))
+        {
+            Stopwatch watch;
+
+            for (int i = 0; i < iterations; ++i)
+            {
+                watch.start();
+                repeatable[name]();
+                watch.stop();
+            }
+
+            cerr << setw(12) << watch.nanoseconds / 1e6 / iterations;
+            rerun += watch.nanoseconds / 1e6 / iterations;
+        }
+
+        cerr << "\n";
+    }
+
+    cerr << left << setw(24) << "Total" << right << setw(14) << startup << setw(12) << rerun
+         << defaultfloat << "\n" << endl;
+  }
+
+
+  // bench_latency() is called for "bench latency [threads] [iterations] [spin]".
+  // It measures the time from "go" to "bestmove" for a depth 1 search, and from
+  // a stop to "bestmove" for an infinite search, without "Spin Wait" and then
+  // with it set to 'spin' milliseconds. The options are restored afterwards.
+
+  void bench_latency(Position& pos, istream& args, StateListPtr& states) {
+
+    const string usage = "bench latency [threads] [iterations] [spin]";
+    const int threadsDefault = int(Options["Threads"]), spinDefault = int(Options["Spin Wait"]);
+    string token;
+    int threads = threadsDefault, iterations = 100, spin = 100;
+
+    if (   ((args >> token) && !bench_arg(token, threads, 1, usage))
+        || ((args >> token) && !bench_arg(token, iterations, 1, usage))
+        || ((args >> token) && !bench_arg(token, spin, 0, usage)))
+        return;
+
+    Options["Threads"] = to_string(threads);
+
+    ostringstream report;
+    report << left << setw(16) << "Spin Wait (ms)" << right
+           << setw(22) << "go->bestmove (us)" << setw(22) << "stop->bestmove (us)" << "\n"
+           << fixed << setprecision(1);
+
+    for (int spinWait : { 0, spin })
+    {
+        Options["Spin Wait"] = to_string(spinWait);
+
+        istringstream ps("startpos");
+        position(pos, ps, states);
+        Search::clear();
+
+        Stopwatch goToBestmove, stopToBestmove;
+
+        for (int i = 0; i < iterations; ++i)
+        {
+            istringstream depth1("depth 1"), infinite("infinite");
+
+            goToBestmove.start();
+            go(pos, depth1, states);
+            Threads.main()->wait_for_search_finished();
+            goToBestmove.stop();
+
+            go(pos, infinite, states);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+            stopToBestmove.start();
+            Threads.stop = true;
+            Threads.main()->wait_for_search_finished();
+            stopToBestmove.stop();
+
+            // Leave the threads idle for a while, as between two moves
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        report << left << setw(16) << spinWait << right
+               << setw(22) << goToBestmove.nanoseconds / 1000.0 / iterations
+               << setw(22) << stopToBestmove.nanoseconds / 1000.0 / iterations << "\n";
+    }
+
+    Options["Threads"] = to_string(threadsDefault);
+    Options["Spin Wait"] = to_string(spinDefault);
+
+    cerr << "\n===========================\nThreads: " << threads << "\n\n"
+         << report.str() << endl;
+  }
+
+
   // bench() is called when engine receives the "bench" command. Firstly
   // a list of UCI commands is setup according to bench parameters, then
   // it is run one by one printing a summary at the end.
@@ -165,6 +871,46 @@ namespace {
 
     string token;
     uint64_t num, nodes = 0, cnt = 1;
+    Search::Stats stats;
+
+    streampos start = args.tellg();
+    if ((args >> token) && token == "eval")
+    {
+        bench_eval(pos, args);
+        return;
+    }
+    if (token == "history")
+    {
+        bench_history(pos, args, states);
+        return;
+    }
+    if (token == "tables")
+    {
+        bench_tables(pos, args, states);
+        return;
+    }
+    if (token == "startup")
+    {
+        bench_startup(args);
+        return;
+    }
+    if (token == "latency")
+    {
+        bench_latency(pos, args, states);
+        return;
+    }
+    if (token == "moves")
+    {
+        bench_moves(pos, args);
+        return;
+    }
+    if (token == "fen")
+    {
+        bench_fen(pos, args);
+        return;
+    }
+    args.clear();
+    args.seekg(start);
 
     vector<string> list = setup_bench(pos, args);
     num = count_if(list.begin(), list.end(), [](string s) { return s.find("go ") == 0 || s.find("eval") == 0; });
@@ -184,6 +930,7 @@ namespace {
                go(pos, is, states);
                Threads.main()->wait_for_search_finished();
                nodes += Threads.nodes_searched();
+               stats += Threads.stats();
             }
             else
                trace_eval(pos);
@@ -201,6 +948,36 @@ namespace {
          << "\nTotal time (ms) : " << elapsed
          << "\nNodes searched  : " << nodes
          << "\nNodes/second    : " << 1000 * nodes / elapsed << endl;
+
+    if (Eval::useNNUE)
+    {
+        uint64_t updates         = stats[Search::Stats::NNUE_UPDATES];
+        uint64_t plies           = stats[Search::Stats::NNUE_UPDATED_PLIES];
+        uint64_t refreshes       = stats[Search::Stats::NNUE_REFRESHES];
+        uint64_t cachedRefreshes = stats[Search::Stats::NNUE_CACHED_REFRESHES];
+
+        cerr << "NNUE updates    : " << updates
+             << " (" << double(plies) / std::max(updates, uint64_t(1)) << " plies each)"
+             << "\nNNUE refreshes  : " << refreshes + cachedRefreshes
+             << " (" << cachedRefreshes << " from cache)" << endl;
+    }
+
+    // The evaluation caches and tables, when they were used
+    auto report_hits = [](const string& name, uint64_t hits, uint64_t probes) {
+        if (probes)
+            cerr << name << hits << " of " << probes
+                 << " (" << 100.0 * hits / probes << "%)" << endl;
+    };
+
+    using S = Search::Stats;
+    report_hits("Pawn table hits : ", stats[S::PAWN_TABLE_HITS],
+                stats[S::PAWN_TABLE_HITS] + stats[S::PAWN_TABLE_MISSES]);
+    report_hits("Material hits   : ", stats[S::MATERIAL_TABLE_HITS],
+                stats[S::MATERIAL_TABLE_HITS] + stats[S::MATERIAL_TABLE_MISSES]);
+
+#if defined(USE_STATS)
+    cerr << "Search stats    : " << stats.search_info() << endl;
+#endif
   }
 
   // The win rate model returns the probability (per mille) of winning given an eval
@@ -286,8 +1063,12 @@ void UCI::loop(int argc, char* argv[]) {
       // Do not use these commands during a search!
       else if (token == "flip")     pos.flip();
       else if (token == "bench")    bench(pos, is, states);
+      else if (token == "analyse")  analyse(is);
+      else if (token == "idea")     idea(pos, is);
       else if (token == "d")        sync_cout << pos << sync_endl;
       else if (token == "eval")     trace_eval(pos);
+      else if (token == "evalbatch") evalbatch(is);
+      else if (token == "export_blob") export_blob(is);
       else if (token == "compiler") sync_cout << compiler_info() << sync_endl;
       else if (argc > 1 && token == "defrag")   Experience::defrag(argc, argv);
       else if (argc > 1 && token == "merge")    Experience::merge(argc, argv);
@@ -377,6 +1158,72 @@ string UCI::move(Move m, bool chess960) {
 }
 
 
+/// UCI::san() converts a legal Move to Standard Algebraic Notation (Nf3, exd5,
+/// O-O, e8=Q+), as used by the "bm" and "pv" operations of EPD.
+
+string UCI::san(Position& pos, Move m) {
+
+  if (m == MOVE_NONE)
+      return "(none)";
+
+  Square from = from_sq(m);
+  Square to = to_sq(m);
+  PieceType pt = type_of(pos.moved_piece(m));
+  string san;
+
+  if (type_of(m) == CASTLING)
+      san = to > from ? "O-O" : "O-O-O";
+  else
+  {
+      if (pt != PAWN)
+      {
+          san = " PNBRQK"[pt];
+
+          // Disambiguate from the other pieces of the same type reaching 'to'
+          bool ambiguous = false, sameFile = false, sameRank = false;
+
+          for (const auto& m2 : MoveList<LEGAL>(pos))
+              if (   to_sq(m2) == to
+                  && from_sq(m2) != from
+                  && type_of(m2) != CASTLING
+                  && type_of(pos.moved_piece(m2)) == pt)
+              {
+                  ambiguous = true;
+                  sameFile |= file_of(from_sq(m2)) == file_of(from);
+                  sameRank |= rank_of(from_sq(m2)) == rank_of(from);
+              }
+
+          if (ambiguous)
+              san += !sameFile ? string(1, char('a' + file_of(from)))
+                   : !sameRank ? string(1, char('1' + rank_of(from)))
+                               : UCI::square(from);
+      }
+
+      if (pos.capture(m))
+      {
+          if (pt == PAWN)
+              san += char('a' + file_of(from));
+          san += 'x';
+      }
+
+      san += UCI::square(to);
+
+      if (type_of(m) == PROMOTION)
+          san += string("=") + " PNBRQK"[promotion_type(m)];
+  }
+
+  if (pos.gives_check(m))
+  {
+      StateInfo st;
+      pos.do_move(m, st);
+      san += MoveList<LEGAL>(pos).size() ? "+" : "#";
+      pos.undo_move(m);
+  }
+
+  return san;
+}
+
+
 /// UCI::to_move() converts a string representing a move in coordinate notation
 /// (g1f3, a7a8q) to the corresponding legal Move, if any.
 
@@ -21,6 +21,8 @@
 
 #include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "types.h"
 
@@ -70,10 +72,14 @@ void loop(int argc, char* argv[]);
 std::string value(Value v, Value v2);
 std::string square(Square s);
 std::string move(Move m, bool chess960);
+std::string san(Position& pos, Move m);
 std::string pv(const Position& pos, Depth depth, Value alpha, Value beta);
 std::string wdl(Value v, int ply);
 Move to_move(const Position& pos, std::string& str);
 
+// The nanoseconds taken by each initialization step of main()
+extern std::vector<std::pair<std::string, uint64_t>> startupTimes;
+
 } // namespace UCI
 
 extern UCI::OptionsMap Options;
@@ -43,6 +43,9 @@ void on_hash_size(const Option& o) { TT.resize(size_t(o)); }
 void on_logger(const Option& o) { start_logger(o); }
 void on_threads(const Option& o) { Threads.set(size_t(o)); }
 void on_full_threads(const Option& o) { Threads.setFull(o); }
+void on_history_sharing(const Option&) { Threads.set(size_t(Options["Threads"])); }
+void on_spin_wait(const Option& o) { Threads.spinWait = TimePoint(int(o)); }
+void on_eval_tables(const Option&) { Threads.resize_eval_tables(); }
 void on_tb_path(const Option& o) { Tablebases::init(o); }
 void on_HashFile(const Option& o) { TT.set_hash_file_name(o); }
 void SaveHashtoFile(const Option&) { TT.save(); }
@@ -77,8 +80,13 @@ void init(OptionsMap& o) {
   o["Analysis Contempt"]         << Option("Off var Off var White var Black var Both", "Off");
   o["Threads"]                   << Option(1, 1, 512, on_threads);
   o["BruteForceSearch"]          << Option(0, 0, 512, on_full_threads); //if this is used, must be after #Threads is set.
+  o["ABDADA"]                    << Option(false);
+  o["History Sharing"]           << Option(1, 1, 512, on_history_sharing);
+  o["Spin Wait"]                 << Option(0, 0, 1000, on_spin_wait);
   o["Hash"]                      << Option(16, 1, MaxHashMB, on_hash_size);
   o["Clear Hash"]                << Option(on_clear_hash);
+  o["Pawn Hash"]                 << Option(12288, 1, 1048576, on_eval_tables);
+  o["Material Hash"]             << Option(320, 1, 65536, on_eval_tables);
   o["Clean Search"]              << Option(false);
   o["Ponder"]                    << Option(false);
   o["MultiPV"]                   << Option(1, 1, 500);
@@ -94,6 +102,7 @@ void init(OptionsMap& o) {
   o["UCI_AnalyseMode"]           << Option(false);
   o["ShowWDL"]                   << Option(false);
   o["multiPV Search"]            << Option(0, 0,  8);
+  o["Parallel MultiPV"]          << Option(false);
   o["SyzygyPath"]                << Option("<empty>", on_tb_path);
   o["SyzygyProbeDepth"]          << Option(1, 1, 100);
   o["Syzygy50MoveRule"]          << Option(true);
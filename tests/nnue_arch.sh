@@ -0,0 +1,130 @@
+#!/bin/bash
+# verify the HalfKP 128x2-32-32 architecture with a generated net: its
+# evaluations must match those of a reference implementation of the network
+
+error()
+{
+  echo "nnue architecture testing failed on line $1"
+  exit 1
+}
+trap 'error ${LINENO}' ERR
+
+echo "nnue architecture testing started"
+
+cat << EOF > nnue_arch.epd
+rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1
+r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1
+r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R b KQkq - 0 1
+8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1
+rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8
+r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10
+4k3/8/8/8/8/8/8/4K2R b K - 0 1
+EOF
+
+# Write a net of small random weights, and the expected output of 'evalbatch'
+# and of the NNUE line of 'eval' for the positions above
+python3 - << EOF
+import random, struct
+from array import array
+
+Half, Inputs = 128, 64 * 641
+rng = random.Random(20210101)
+
+def values(n, shift):
+    return [b >> shift for b in array('b', rng.getrandbits(8 * n).to_bytes(n, 'little'))]
+
+def affine_hash(prev, out):
+    h = (0xCC03DAE4 + out) & 0xFFFFFFFF
+    return h ^ (prev >> 1) ^ ((prev << 31) & 0xFFFFFFFF)
+
+def relu_hash(prev):
+    return (0x538D24C7 + prev) & 0xFFFFFFFF
+
+ftHash = 0x5D69D5B9 ^ 1 ^ (2 * Half)
+netHash = 0xEC42E90D ^ (2 * Half)
+for out in (32, 32):
+    netHash = relu_hash(affine_hash(netHash, out))
+netHash = affine_hash(netHash, 1)
+
+ftBiases, ftWeights = [32 + b for b in values(Half, 3)], values(Half * Inputs, 2)
+layers = [(values(32, 0), values(32 * 2 * Half, 3)),
+          (values(32, 0), values(32 * 32, 3)),
+          (values(1, 0), values(32, 0))]
+
+desc = b"Features=HalfKP(Friend)[41024->128x2],Network=AffineTransform[1<-32](ClippedReLU[32](AffineTransform[32<-32](ClippedReLU[32](AffineTransform[32<-256](InputSlice[256(0:256)])))))"
+with open("nnue_arch.nnue", "wb") as f:
+    f.write(struct.pack("<III", 0x7AF32F16, ftHash ^ netHash, len(desc)) + desc)
+    f.write(struct.pack("<I", ftHash) + array("h", ftBiases).tobytes() + array("h", ftWeights).tobytes())
+    f.write(struct.pack("<I", netHash))
+    for biases, weights in layers:
+        f.write(array("i", biases).tobytes() + array("b", weights).tobytes())
+
+def evaluate(fen):
+    fields = fen.split()
+    pieces, kings = [], {}
+    for r, row in enumerate(fields[0].split("/")):
+        f = 0
+        for c in row:
+            if c.isdigit():
+                f += int(c)
+                continue
+            sq, color = (7 - r) * 8 + f, 0 if c.isupper() else 1
+            if c.lower() == "k":
+                kings[color] = sq
+            else:
+                pieces.append((sq, color, "pnbrq".index(c.lower())))
+            f += 1
+
+    accumulators = []
+    for persp in (0, 1):
+        orient = 0 if persp == 0 else 63
+        acc = list(ftBiases)
+        for sq, color, pt in pieces:
+            index = (sq ^ orient) + 1 + 64 * (2 * pt + (color != persp)) + 641 * (kings[persp] ^ orient)
+            row = ftWeights[index * Half:(index + 1) * Half]
+            acc = [a + w for a, w in zip(acc, row)]
+        accumulators.append(acc)
+
+    stm = 0 if fields[1] == "w" else 1
+    x = [min(max(a, 0), 127) for a in accumulators[stm] + accumulators[1 - stm]]
+    for i, (biases, weights) in enumerate(layers):
+        x = [b + sum(w * v for w, v in zip(weights[o * len(x):(o + 1) * len(x)], x))
+             for o, b in enumerate(biases)]
+        if i < 2:
+            x = [min(max(v >> 6, 0), 127) for v in x]
+    return int(x[0] / 16)
+
+def trunc_div(a, b):
+    return -(-a // b) if a < 0 else a // b
+
+with open("nnue_arch.epd") as epd, open("nnue_arch.expected", "w") as expected:
+    fens = [line.strip() for line in epd if line.strip()]
+    evals = [evaluate(fen) for fen in fens]
+    expected.write("\n".join(" ".join(fen.split()[:4]) + " ce %d;" % trunc_div(v * 100, 208)
+                             for fen, v in zip(fens, evals)) + "\n")
+    for fen, v in zip(fens, evals):
+        expected.write("NNUE evaluation:      %.2f (white side)\n" % ((v if " w " in fen else -v) / 208))
+EOF
+
+# Evaluate them with the engine, in batches and one at a time, then search with
+# the net to go through the incremental updates of the accumulators
+{
+  echo "setoption name Experience Enabled value false"
+  echo "setoption name EvalFile value nnue_arch.nnue"
+  echo "setoption name Threads value 2"
+  echo "evalbatch nnue_arch.epd"
+  while read -r fen; do
+    echo "position fen $fen"
+    echo "eval"
+  done < nnue_arch.epd
+  echo "bench 16 2 8 nnue_arch.epd depth NNUE"
+  echo "quit"
+} | ./stockfish > nnue_arch.out 2>&1
+
+grep -E " ce -?[0-9]+;$|^NNUE evaluation:" nnue_arch.out > nnue_arch.obtained
+diff nnue_arch.expected nnue_arch.obtained
+grep -q "Nodes searched  : " nnue_arch.out
+
+rm nnue_arch.epd nnue_arch.nnue nnue_arch.expected nnue_arch.obtained nnue_arch.out
+
+echo "nnue architecture testing OK"